@@ -1,13 +1,52 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <map>
+#include <unordered_map>
 #include <ctime>
 #include <iomanip>
 #include <regex>
+#include <memory_resource>
+#include <charconv>
+#include <cctype>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <queue>
+#include <list>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <csignal>
+#include <climits>
+#include <chrono>
+#include <bit>
+#include <cstdio>
+#include <filesystem>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+#define TASKREAPER_HAS_UNIX_SOCKETS 1
+#define TASKREAPER_HAS_POSIX_IO 1
+#endif
+#if defined(TASKREAPER_IO_URING) && defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#define TASKREAPER_HAS_IO_URING 1
+#endif
 using namespace std;
 
 // Utility class for date operations
@@ -34,123 +73,5256 @@ public:
     }
 
     static string getCurrentDate() {
-        time_t now = time(0);
-        tm* ltm = localtime(&now);
-        ostringstream oss;
-        oss << (1900 + ltm->tm_year) << "-"
-            << setfill('0') << setw(2) << (1 + ltm->tm_mon) << "-"
-            << setfill('0') << setw(2) << ltm->tm_mday;
-        return oss.str();
+        return string(today());
     }
 
-    static bool isOverdue(const string& dueDate) {
-        return dueDate < getCurrentDate();
+    // Thread-safe localtime(); the server evaluates dates on many threads
+    static tm localDate(time_t when) {
+        tm result{};
+#ifdef _WIN32
+        localtime_s(&result, &when);
+#else
+        localtime_r(&when, &result);
+#endif
+        return result;
     }
 
-    static bool isDueSoon(const string& dueDate, int days = 3) {
-        time_t now = time(0);
-        tm* ltm = localtime(&now);
-        ltm->tm_mday += days;
-        mktime(ltm); // Normalize the date
+    // Today's date formatted into a per-thread buffer, so the per-task
+    // overdue/due-soon checks never touch the heap
+    static string_view today() {
+        thread_local char buf[11];
+        tm now = localDate(time(0));
+        strftime(buf, sizeof(buf), "%Y-%m-%d", &now);
+        return string_view(buf, 10);
+    }
+
+    static bool isOverdue(string_view dueDate) {
+        return dueDate < today();
+    }
+
+    static bool isDueSoon(string_view dueDate, int days = 3) {
+        tm date = localDate(time(0));
+        date.tm_mday += days;
+        mktime(&date); // Normalize the date
+
+        char soon[11];
+        strftime(soon, sizeof(soon), "%Y-%m-%d", &date);
+
+        return dueDate <= string_view(soon, 10) && dueDate >= today();
+    }
+
+    // Day numbers count days since 1970-01-01 in the proleptic Gregorian
+    // calendar (H. Hinnant's days_from_civil), so date stepping is integer
+    // math instead of a mktime round-trip per date
+    static int32_t toDayNumber(int y, unsigned m, unsigned d) {
+        y -= m <= 2;
+        int era = (y >= 0 ? y : y - 399) / 400;
+        unsigned yoe = (unsigned)(y - era * 400);
+        unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+        unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + (int32_t)doe - 719468;
+    }
+
+    // Local calendar day of a point in time
+    static int32_t dayOf(time_t when) {
+        tm date = localDate(when);
+        return toDayNumber(date.tm_year + 1900, (unsigned)date.tm_mon + 1, (unsigned)date.tm_mday);
+    }
+
+    static int32_t todayNumber() {
+        int32_t days = 0;
+        toDayNumber(today(), days);
+        return days;
+    }
+
+    // Parses YYYY-MM-DD; leaves days untouched and returns false otherwise
+    static bool toDayNumber(string_view date, int32_t& days) {
+        if (date.size() != 10 || date[4] != '-' || date[7] != '-') return false;
+        int y = 0;
+        unsigned m = 0, d = 0;
+        auto field = [&](size_t pos, size_t len, auto& value) {
+            const char* end = date.data() + pos + len;
+            auto result = from_chars(date.data() + pos, end, value);
+            return result.ec == errc() && result.ptr == end;
+        };
+        if (!field(0, 4, y) || !field(5, 2, m) || !field(8, 2, d)) return false;
+        if (m < 1 || m > 12 || d < 1 || d > daysInMonth(y, m)) return false;
+        days = toDayNumber(y, m, d);
+        return true;
+    }
+
+    static void fromDayNumber(int32_t days, int& y, unsigned& m, unsigned& d) {
+        days += 719468;
+        int era = (days >= 0 ? days : days - 146096) / 146097;
+        unsigned doe = (unsigned)(days - era * 146097);
+        unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        unsigned mp = (5 * doy + 2) / 153;
+        d = doy - (153 * mp + 2) / 5 + 1;
+        m = mp < 10 ? mp + 3 : mp - 9;
+        y = (int)yoe + era * 400 + (m <= 2);
+    }
+
+    // Formats a day number as YYYY-MM-DD into out, which must hold 10 chars
+    static string_view formatDay(int32_t days, char* out) {
+        int y;
+        unsigned m, d;
+        fromDayNumber(days, y, m, d);
+        auto put = [](char* at, unsigned value, int width) {
+            for (int i = width - 1; i >= 0; --i, value /= 10) at[i] = char('0' + value % 10);
+        };
+        put(out, (unsigned)y, 4);
+        out[4] = '-';
+        put(out + 5, m, 2);
+        out[7] = '-';
+        put(out + 8, d, 2);
+        return string_view(out, 10);
+    }
+
+    static unsigned daysInMonth(int y, unsigned m) {
+        static const unsigned lengths[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+        return m == 2 && leap ? 29 : lengths[m - 1];
+    }
+};
+
+// Utility class for string operations
+class StringUtils {
+public:
+    // Case-insensitive substring test; the needle must already be lowercase
+    static bool containsIgnoreCase(string_view haystack, string_view lowerNeedle) {
+        auto it = search(haystack.begin(), haystack.end(), lowerNeedle.begin(), lowerNeedle.end(),
+                         [](char a, char b) { return tolower((unsigned char)a) == b; });
+        return it != haystack.end() || lowerNeedle.empty();
+    }
+
+    // Splits a line on a delimiter into views over the line, up to maxFields
+    static size_t split(string_view line, char delim, string_view* fields, size_t maxFields) {
+        size_t count = 0;
+        while (count < maxFields) {
+            size_t pos = line.find(delim);
+            fields[count++] = line.substr(0, pos);
+            if (pos == string_view::npos) break;
+            line.remove_prefix(pos + 1);
+        }
+        return count;
+    }
+
+    static int toInt(string_view text, int fallback = 0) {
+        int value = fallback;
+        from_chars(text.data(), text.data() + text.size(), value);
+        return value;
+    }
+
+    static uint64_t toU64(string_view text, uint64_t fallback = 0) {
+        uint64_t value = fallback;
+        from_chars(text.data(), text.data() + text.size(), value);
+        return value;
+    }
+
+    // Byte count in B, KiB, MiB or GiB with one decimal
+    static string formatBytes(size_t bytes) {
+        static const char* units[] = {"B", "KiB", "MiB", "GiB"};
+        double value = (double)bytes;
+        int unit = 0;
+        while (value >= 1024 && unit < 3) {
+            value /= 1024;
+            unit++;
+        }
+        char buf[32];
+        snprintf(buf, sizeof(buf), unit ? "%.1f %s" : "%.0f %s", value, units[unit]);
+        return buf;
+    }
+};
+
+// Scoped spans for --trace, written out as Chrome trace-event JSON (load it in
+// chrome://tracing or Perfetto). Each thread appends finished spans to its own
+// fixed-size ring, overwriting the oldest, so recording takes no lock. Only
+// built with TASKREAPER_TRACING; otherwise TRACE_SPAN expands to nothing and
+// its arguments are never evaluated.
+#ifdef TASKREAPER_TRACING
+class Trace {
+public:
+    static constexpr size_t RING_EVENTS = 1 << 15; // per thread
+    static constexpr size_t DETAIL_CHARS = 23;
+
+private:
+    struct Event {
+        const char* name; // string literal
+        char detail[DETAIL_CHARS + 1];
+        uint64_t start, duration; // nanoseconds since the trace started
+    };
+
+    struct Ring {
+        unsigned threadId = 0;
+        vector<Event> events = vector<Event>(RING_EVENTS);
+        atomic<uint64_t> written{0};
+    };
+
+    // Rings are owned here rather than by their threads so spans from
+    // threads that have exited still make it into the file. An exiting
+    // thread's ring goes on `idle` and the next new thread records into it,
+    // so a server starting a thread per client doesn't grow a ring each time.
+    struct Registry {
+        mutex lock;
+        vector<unique_ptr<Ring>> rings;
+        vector<Ring*> idle;
+        string path;
+    };
+
+    // Holds a thread's ring and hands it back when the thread exits
+    struct Lease {
+        Ring* ring = nullptr;
+        ~Lease() {
+            if (!ring) return;
+            Registry& shared = registry();
+            lock_guard<mutex> guard(shared.lock);
+            shared.idle.push_back(ring);
+        }
+    };
+
+    static inline atomic<bool> enabled{false};
+    static inline chrono::steady_clock::time_point epoch;
+
+    static Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    static Ring& ring() {
+        thread_local Lease mine;
+        if (!mine.ring) {
+            Registry& shared = registry();
+            lock_guard<mutex> guard(shared.lock);
+            if (!shared.idle.empty()) {
+                mine.ring = shared.idle.back();
+                shared.idle.pop_back();
+            } else {
+                shared.rings.push_back(make_unique<Ring>());
+                mine.ring = shared.rings.back().get();
+                mine.ring->threadId = (unsigned)shared.rings.size();
+            }
+        }
+        return *mine.ring;
+    }
+
+    static uint64_t now() {
+        return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+    }
+
+    static void copyDetail(char* out, string_view detail) {
+        size_t length = min(detail.size(), DETAIL_CHARS);
+        if (length) memcpy(out, detail.data(), length); // an empty view may hold a null pointer
+        out[length] = '\0';
+    }
+
+    static void record(const char* name, const char* detail, uint64_t start) {
+        Ring& mine = ring();
+        uint64_t index = mine.written.load(memory_order_relaxed);
+        Event& event = mine.events[index % RING_EVENTS];
+        event.name = name;
+        copyDetail(event.detail, detail);
+        event.start = start;
+        event.duration = now() - start;
+        mine.written.store(index + 1, memory_order_release);
+    }
+
+    // Trace timestamps are microseconds; keep the nanoseconds as a fraction
+    static void writeMicros(ostream& out, uint64_t nanoseconds) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%llu.%03llu", (unsigned long long)(nanoseconds / 1000),
+                 (unsigned long long)(nanoseconds % 1000));
+        out << buf;
+    }
+
+    static void writeString(ostream& out, const char* text) {
+        out << '"';
+        for (; *text; ++text) {
+            unsigned char c = (unsigned char)*text;
+            if (c == '"' || c == '\\') out << '\\' << (char)c;
+            else if (c < 0x20) out << ' ';
+            else out << (char)c;
+        }
+        out << '"';
+    }
+
+public:
+    static bool isEnabled() { return enabled.load(memory_order_relaxed); }
+
+    // Starts recording; the trace is written to path when the program exits
+    static void start(const string& path) {
+        registry().path = path; // constructed before the exit handler, so it outlives it
+        epoch = chrono::steady_clock::now();
+        enabled.store(true);
+        atexit([] {
+            if (!write(registry().path)) cerr << "Could not write trace to " << registry().path << "\n";
+        });
+    }
+
+    static bool write(const string& path) {
+        ofstream out(path);
+        if (!out.is_open()) return false;
+        Registry& shared = registry();
+        lock_guard<mutex> guard(shared.lock);
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (const auto& mine : shared.rings) {
+            out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+                << mine->threadId << ",\"args\":{\"name\":\"thread " << mine->threadId << "\"}}";
+            first = false;
+
+            uint64_t written = mine->written.load(memory_order_acquire);
+            for (uint64_t i = written > RING_EVENTS ? written - RING_EVENTS : 0; i < written; ++i) {
+                const Event& event = mine->events[i % RING_EVENTS];
+                out << ",\n{\"name\":";
+                writeString(out, event.name);
+                out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << mine->threadId << ",\"ts\":";
+                writeMicros(out, event.start);
+                out << ",\"dur\":";
+                writeMicros(out, event.duration);
+                if (event.detail[0]) {
+                    out << ",\"args\":{\"detail\":";
+                    writeString(out, event.detail);
+                    out << "}";
+                }
+                out << "}";
+            }
+        }
+        out << "\n]}\n";
+        return bool(out);
+    }
+
+    // Records the enclosing scope as one complete ("X") event
+    class Span {
+    private:
+        const char* name;
+        char detail[DETAIL_CHARS + 1];
+        uint64_t start = 0;
+        bool active;
+
+    public:
+        explicit Span(const char* spanName, string_view spanDetail = {}) : name(spanName), active(isEnabled()) {
+            if (!active) return;
+            copyDetail(detail, spanDetail);
+            start = now();
+        }
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+        ~Span() {
+            if (active) record(name, detail, start);
+        }
+    };
+};
+
+#define TRACE_JOIN_(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN_(a, b)
+#define TRACE_SPAN(...) Trace::Span TRACE_JOIN(traceSpan, __LINE__)(__VA_ARGS__)
+#else
+#define TRACE_SPAN(...) ((void)0)
+#endif
+
+// Recurrence of a task: every `interval` days, weeks or months counted from
+// the series start, optionally ending on `untilDay`. Occurrences are worked
+// out from the rule when asked for and never stored as tasks.
+struct RecurrenceRule {
+    enum Frequency : uint8_t { NONE, DAILY, WEEKLY, MONTHLY };
+
+    Frequency frequency = NONE;
+    uint16_t interval = 1;
+    int32_t startDay = 0; // day number of the first occurrence
+    int32_t untilDay = 0; // last day an occurrence may fall on, 0 = no end
+
+    bool active() const { return frequency != NONE; }
+    bool hasEnd() const { return untilDay != 0; }
+
+    static Frequency parseFrequency(string_view name) {
+        if (name == "daily") return DAILY;
+        if (name == "weekly") return WEEKLY;
+        if (name == "monthly") return MONTHLY;
+        return NONE;
+    }
+
+    string_view name() const {
+        switch (frequency) {
+            case DAILY: return "daily";
+            case WEEKLY: return "weekly";
+            case MONTHLY: return "monthly";
+            default: return "";
+        }
+    }
+
+    // Day number of occurrence n (0 is the start). Monthly series keep the
+    // start's day of month, clamped in shorter months (Jan 31 -> Feb 28 -> Mar 31)
+    int32_t occurrence(int64_t n) const {
+        switch (frequency) {
+            case DAILY: return startDay + (int32_t)(n * interval);
+            case WEEKLY: return startDay + (int32_t)(n * interval * 7);
+            case MONTHLY: {
+                int y;
+                unsigned m, d;
+                DateUtils::fromDayNumber(startDay, y, m, d);
+                int64_t months = (int64_t)(m - 1) + n * interval;
+                int year = y + (int)(months / 12);
+                unsigned month = (unsigned)(months % 12) + 1;
+                return DateUtils::toDayNumber(year, month, min(d, DateUtils::daysInMonth(year, month)));
+            }
+            default: return startDay;
+        }
+    }
+
+    // Index of the first occurrence on or after day, computed directly so a
+    // window far from the start doesn't walk every occurrence before it
+    int64_t firstOnOrAfter(int32_t day) const {
+        if (!active() || day <= startDay) return 0;
+        if (frequency == MONTHLY) {
+            int y0, y1;
+            unsigned m0, m1, d;
+            DateUtils::fromDayNumber(startDay, y0, m0, d);
+            DateUtils::fromDayNumber(day, y1, m1, d);
+            int64_t months = (int64_t)(y1 - y0) * 12 + (int64_t)m1 - (int64_t)m0;
+            int64_t n = max<int64_t>(0, months / interval - 1);
+            while (occurrence(n) < day) n++;
+            return n;
+        }
+        int64_t step = frequency == WEEKLY ? 7 * interval : interval;
+        return (day - startDay + step - 1) / step;
+    }
+
+    // The first occurrence strictly after day; false once the series has ended
+    bool nextAfter(int32_t day, int32_t& next) const {
+        if (!active()) return false;
+        next = occurrence(firstOnOrAfter(day + 1));
+        return !hasEnd() || next <= untilDay;
+    }
+};
+
+// Enhanced Task class
+// Allocator-aware: when stored in a pmr container its strings are allocated
+// from the container's memory resource (see ToDoList's session arena).
+class Task {
+public:
+    using allocator_type = pmr::polymorphic_allocator<char>;
+
+private:
+    uint64_t id; // stable across sessions, assigned by the owning list
+    pmr::string description;
+    bool isCompleted;
+    int priority;
+    pmr::string dueDate;
+    pmr::string category;
+    RecurrenceRule recurrence; // dueDate is the next pending occurrence
+    bool isDeleted = false;    // tombstone, see TaskStore::remove
+    int32_t completedDay;      // day number of the latest completion, or NO_DAY
+
+public:
+    static constexpr int32_t NO_DAY = INT32_MIN;
+
+    Task(uint64_t taskId, string_view desc, int prio, string_view due, string_view cat = "General",
+         const allocator_type& alloc = {})
+        : id(taskId), description(desc, alloc), isCompleted(false), priority(prio),
+          dueDate(due, alloc), category(cat, alloc), completedDay(NO_DAY) {}
+
+    Task(const Task& other) = default;
+    Task(Task&& other) = default;
+    Task& operator=(const Task& other) = default;
+    Task& operator=(Task&& other) = default;
+
+    // Allocator-extended copy/move, used by pmr containers
+    Task(const Task& other, const allocator_type& alloc)
+        : id(other.id), description(other.description, alloc), isCompleted(other.isCompleted),
+          priority(other.priority), dueDate(other.dueDate, alloc), category(other.category, alloc),
+          recurrence(other.recurrence), isDeleted(other.isDeleted), completedDay(other.completedDay) {}
+
+    Task(Task&& other, const allocator_type& alloc)
+        : id(other.id), description(std::move(other.description), alloc), isCompleted(other.isCompleted),
+          priority(other.priority), dueDate(std::move(other.dueDate), alloc),
+          category(std::move(other.category), alloc), recurrence(other.recurrence),
+          isDeleted(other.isDeleted), completedDay(other.completedDay) {}
+
+    // Getters (views stay valid until the task is modified or destroyed)
+    uint64_t getId() const { return id; }
+    string_view getDescription() const { return description; }
+    bool getIsCompleted() const { return isCompleted; }
+    int getPriority() const { return priority; }
+    string_view getDueDate() const { return dueDate; }
+    string_view getCategory() const { return category; }
+    bool getIsRecurring() const { return recurrence.active(); }
+    string_view getRecurringType() const { return recurrence.name(); }
+    const RecurrenceRule& getRecurrence() const { return recurrence; }
+    bool getIsDeleted() const { return isDeleted; }
+    int32_t getCompletedDay() const { return completedDay; }
+
+    // Bytes a string holds outside the object; short strings are stored inline
+    static size_t heapBytes(const pmr::string& text) {
+        const char* data = text.data();
+        bool inline_ = data >= (const char*)&text && data < (const char*)(&text + 1);
+        return inline_ ? 0 : text.capacity() + 1;
+    }
+
+    void addStringBytes(size_t& descriptionBytes, size_t& categoryBytes, size_t& dueBytes) const {
+        descriptionBytes += heapBytes(description);
+        categoryBytes += heapBytes(category);
+        dueBytes += heapBytes(dueDate);
+    }
+
+    // Setters assign in place, reusing the existing buffer when it fits
+    void setDescription(string_view desc) { description.assign(desc); }
+    void setDescription(pmr::string&& desc) { description = std::move(desc); }
+    void setId(uint64_t taskId) { id = taskId; }
+    void setPriority(int prio) { priority = prio; }
+    void setDueDate(string_view due) { dueDate.assign(due); }
+    void setCategory(string_view cat) { category.assign(cat); }
+    void setCategory(pmr::string&& cat) { category = std::move(cat); }
+    void markCompleted(int32_t day = NO_DAY) {
+        isCompleted = true;
+        completedDay = day;
+    }
+    // A recurring task stays pending when completed; this only records when
+    void setCompletedDay(int32_t day) { completedDay = day; }
+    void markPending() { isCompleted = false; }
+    void markDeleted() { isDeleted = true; }
+    void markRestored() { isDeleted = false; }
+    void setRecurrence(const RecurrenceRule& rule) { recurrence = rule; }
+
+    // Plain daily/weekly/monthly rule starting at the current due date
+    void setRecurring(string_view type) {
+        recurrence = RecurrenceRule();
+        recurrence.frequency = RecurrenceRule::parseFrequency(type);
+        DateUtils::toDayNumber(dueDate, recurrence.startDay);
+    }
+
+    static string priorityName(int priority) {
+        switch (priority) {
+            case 1: return "High";
+            case 2: return "Medium";
+            case 3: return "Low";
+            default: return to_string(priority);
+        }
+    }
+
+    string getPriorityString() const { return priorityName(priority); }
+
+    bool isOverdue() const {
+        return !isCompleted && DateUtils::isOverdue(dueDate);
+    }
+
+    // Same check against a date captured once by the caller, so a scan over
+    // many tasks doesn't format today's date per task
+    bool isOverdue(string_view today) const {
+        return !isCompleted && dueDate < today;
+    }
+
+    bool isDueSoon() const {
+        return !isCompleted && DateUtils::isDueSoon(dueDate);
+    }
+
+    // How pressing a pending task is, higher first: priority (High 30,
+    // Medium 15, Low 0) plus closeness of the due date (30 when due today,
+    // falling to 0 a month out, up to 60 when a month overdue) plus 20 for
+    // being overdue at all. Completed tasks score -1.
+    int urgency(int32_t today) const {
+        if (isCompleted) return -1;
+        int score = priority >= 1 && priority <= 3 ? (3 - priority) * 15 : 0;
+        int32_t due;
+        if (DateUtils::toDayNumber(dueDate, due)) {
+            int days = due - today;
+            score += clamp(30 - days, 0, 60);
+            if (days < 0) score += 20;
+        }
+        return score;
+    }
+
+    // Moves a recurring task on to its next occurrence after the current due
+    // date, in place. Returns false if it doesn't recur or the series is over.
+    bool advanceRecurrence() {
+        int32_t due, next;
+        if (!recurrence.active() || !DateUtils::toDayNumber(dueDate, due)) return false;
+        if (!recurrence.nextAfter(due, next)) return false;
+
+        char buf[10];
+        dueDate.assign(DateUtils::formatDay(next, buf));
+        isCompleted = false;
+        return true;
+    }
+};
+
+// Conjunction of simple conditions over task fields, parsed from text such as
+// "category=Work and completed" or "due<2025-01-01 and priority<=2"
+class TaskFilter {
+private:
+    enum Field { CATEGORY, PRIORITY, DUE, DESCRIPTION, STATUS };
+    enum Op { EQ, NE, LT, LE, GT, GE, CONTAINS };
+
+    struct Condition {
+        Field field;
+        Op op;
+        string value; // lowercased for description, YYYY-MM-DD for due
+        int number;   // priority
+    };
+
+    vector<Condition> conditions;
+
+    static string_view trim(string_view text) {
+        while (!text.empty() && isspace((unsigned char)text.front())) text.remove_prefix(1);
+        while (!text.empty() && isspace((unsigned char)text.back())) text.remove_suffix(1);
+        return text;
+    }
+
+    static bool compare(Op op, int order) {
+        switch (op) {
+            case EQ: return order == 0;
+            case NE: return order != 0;
+            case LT: return order < 0;
+            case LE: return order <= 0;
+            case GT: return order > 0;
+            case GE: return order >= 0;
+            default: return false;
+        }
+    }
+
+    bool parseCondition(string_view term, string& error) {
+        // Bare status words: "completed", "pending", "overdue"
+        if (term == "completed" || term == "pending" || term == "overdue") {
+            conditions.push_back({STATUS, EQ, string(term), 0});
+            return true;
+        }
+
+        size_t opPos = term.find_first_of("=!<>~");
+        if (opPos == string_view::npos) {
+            error = "expected field, operator and value in '" + string(term) + "'";
+            return false;
+        }
+        string_view name = trim(term.substr(0, opPos));
+        size_t opLen = opPos + 1 < term.size() && term[opPos + 1] == '=' ? 2 : 1;
+        string_view opText = term.substr(opPos, opLen);
+        string_view value = trim(term.substr(opPos + opLen));
+
+        Condition condition{CATEGORY, EQ, string(value), 0};
+        if (opText == "=" || opText == "==") condition.op = EQ;
+        else if (opText == "!=") condition.op = NE;
+        else if (opText == "<") condition.op = LT;
+        else if (opText == "<=") condition.op = LE;
+        else if (opText == ">") condition.op = GT;
+        else if (opText == ">=") condition.op = GE;
+        else if (opText == "~") condition.op = CONTAINS;
+        else {
+            error = "unknown operator '" + string(opText) + "'";
+            return false;
+        }
+        bool ordered = condition.op != EQ && condition.op != NE && condition.op != CONTAINS;
+
+        if (name == "category") {
+            condition.field = CATEGORY;
+            if (ordered || condition.op == CONTAINS) error = "category supports = and != only";
+        } else if (name == "priority") {
+            condition.field = PRIORITY;
+            condition.number = StringUtils::toInt(value);
+            if (condition.number < 1 || condition.number > 3) error = "priority must be 1-3";
+            else if (condition.op == CONTAINS) error = "priority does not support ~";
+        } else if (name == "due") {
+            condition.field = DUE;
+            if (!DateUtils::isValidDate(condition.value)) error = "due date must be YYYY-MM-DD";
+            else if (condition.op == CONTAINS) error = "due does not support ~";
+        } else if (name == "description") {
+            condition.field = DESCRIPTION;
+            if (ordered) error = "description supports =, != and ~ only";
+            if (condition.op == CONTAINS) {
+                transform(condition.value.begin(), condition.value.end(), condition.value.begin(), ::tolower);
+            }
+        } else if (name == "status") {
+            condition.field = STATUS;
+            if (condition.op != EQ && condition.op != NE) error = "status supports = and != only";
+            else if (value != "completed" && value != "pending" && value != "overdue") {
+                error = "status must be completed, pending or overdue";
+            }
+        } else {
+            error = "unknown field '" + string(name) + "'";
+        }
+        if (!error.empty()) return false;
+        conditions.push_back(std::move(condition));
+        return true;
+    }
+
+public:
+    // Terms are joined with "and"; an empty filter is rejected so a bulk
+    // command can never match every task by accident
+    bool parse(string_view text, string& error) {
+        conditions.clear();
+        error.clear();
+        text = trim(text);
+        while (!text.empty()) {
+            size_t pos = text.find(" and ");
+            if (!parseCondition(trim(text.substr(0, pos)), error)) return false;
+            text = pos == string_view::npos ? string_view() : trim(text.substr(pos + 5));
+        }
+        if (conditions.empty()) error = "empty filter";
+        return !conditions.empty();
+    }
+
+    bool matches(const Task& task, string_view today) const {
+        for (const auto& condition : conditions) {
+            bool match = false;
+            switch (condition.field) {
+                case CATEGORY:
+                    match = compare(condition.op, task.getCategory().compare(condition.value));
+                    break;
+                case PRIORITY:
+                    match = compare(condition.op, task.getPriority() - condition.number);
+                    break;
+                case DUE:
+                    match = compare(condition.op, task.getDueDate().compare(condition.value));
+                    break;
+                case DESCRIPTION:
+                    match = condition.op == CONTAINS
+                        ? StringUtils::containsIgnoreCase(task.getDescription(), condition.value)
+                        : compare(condition.op, task.getDescription().compare(condition.value));
+                    break;
+                case STATUS: {
+                    bool is = condition.value == "completed" ? task.getIsCompleted()
+                            : condition.value == "overdue" ? task.isOverdue(today)
+                            : !task.getIsCompleted() && !task.isOverdue(today);
+                    match = condition.op == EQ ? is : !is;
+                    break;
+                }
+            }
+            if (!match) return false;
+        }
+        return true;
+    }
+};
+
+// Compound task query, e.g.
+//   category:Work priority<=2 due:2025-06-01..2025-06-30 status:pending "report" sort:due
+// Terms are ANDed; "or", "not"/"-" and parentheses build the rest of the
+// predicate tree. Quoted or bare words match the description. TaskStore::query
+// plans and runs it.
+class TaskQuery {
+public:
+    struct Node {
+        enum Kind { AND, OR, NOT, CATEGORY, PRIORITY, DUE, STATUS, TEXT };
+        Kind kind;
+        vector<Node> children; // AND, OR, NOT
+        string value;          // category, status, or lowercased text
+        int low = INT_MIN, high = INT_MAX; // priority range, inclusive
+        string from, to;       // due range, inclusive; empty = open
+
+        explicit Node(Kind k = AND, string v = {}) : kind(k), value(std::move(v)) {}
+    };
+
+    enum SortKey { POSITION, DUE, PRIORITY, CATEGORY, DESCRIPTION };
+
+private:
+    struct Token {
+        string text;
+        bool quoted = false; // never a keyword, field or parenthesis
+    };
+
+    Node rootNode;
+    SortKey sortKey = POSITION;
+    bool descending = false;
+    vector<Token> tokens;
+    size_t pos = 0;
+    string error;
+
+    static string lower(string_view text) {
+        string result(text);
+        transform(result.begin(), result.end(), result.begin(), ::tolower);
+        return result;
+    }
+
+    bool tokenize(string_view input) {
+        tokens.clear();
+        Token current;
+        bool inQuote = false, pending = false;
+        auto flush = [&]() {
+            if (pending) tokens.push_back(std::move(current));
+            current = Token();
+            pending = false;
+        };
+        for (char c : input) {
+            if (c == '"') {
+                if (!pending) current.quoted = true;
+                inQuote = !inQuote;
+                pending = true;
+            } else if (inQuote) {
+                current.text += c;
+            } else if (isspace((unsigned char)c)) {
+                flush();
+            } else if (c == '(' || c == ')') {
+                flush();
+                tokens.push_back({string(1, c), false});
+            } else {
+                current.text += c;
+                pending = true;
+            }
+        }
+        if (inQuote) {
+            error = "unterminated quote";
+            return false;
+        }
+        flush();
+        return true;
+    }
+
+    bool atKeyword(string_view keyword) const {
+        return pos < tokens.size() && !tokens[pos].quoted && lower(tokens[pos].text) == keyword;
+    }
+
+    bool parseOr(Node& out) {
+        Node first;
+        if (!parseAnd(first)) return false;
+        if (!atKeyword("or")) {
+            out = std::move(first);
+            return true;
+        }
+        out = Node(Node::OR);
+        out.children.push_back(std::move(first));
+        while (atKeyword("or")) {
+            pos++;
+            Node next;
+            if (!parseAnd(next)) return false;
+            out.children.push_back(std::move(next));
+        }
+        return true;
+    }
+
+    bool parseAnd(Node& out) {
+        out = Node(Node::AND);
+        while (pos < tokens.size() && !atKeyword("or") && !atKeyword(")")) {
+            if (atKeyword("and")) {
+                pos++;
+                continue;
+            }
+            Node term;
+            bool isTerm = true;
+            if (!parseUnary(term, isTerm)) return false;
+            if (isTerm) out.children.push_back(std::move(term));
+        }
+        if (out.children.size() == 1) {
+            Node only = std::move(out.children[0]);
+            out = std::move(only);
+        }
+        return true;
+    }
+
+    // isTerm is cleared for directives such as sort:, which add no predicate
+    bool parseUnary(Node& out, bool& isTerm) {
+        if (atKeyword("not")) {
+            pos++;
+            out = Node(Node::NOT);
+            out.children.emplace_back();
+            if (pos >= tokens.size()) return fail("'not' needs a term");
+            return parseUnary(out.children[0], isTerm);
+        }
+        if (atKeyword("(")) {
+            pos++;
+            if (!parseOr(out)) return false;
+            if (!atKeyword(")")) return fail("missing ')'");
+            pos++;
+            return true;
+        }
+        const Token& token = tokens[pos++];
+        if (token.quoted) {
+            out = Node(Node::TEXT, lower(token.text));
+            return true;
+        }
+        string_view text = token.text;
+        if (text.size() > 1 && text[0] == '-') {
+            out = Node(Node::NOT);
+            out.children.emplace_back();
+            return parseTerm(text.substr(1), out.children[0], isTerm);
+        }
+        return parseTerm(text, out, isTerm);
+    }
+
+    bool fail(string message) {
+        error = std::move(message);
+        return false;
+    }
+
+    static bool shiftDate(string_view date, int days, string& out) {
+        int32_t day;
+        if (!DateUtils::toDayNumber(date, day)) return false;
+        char buf[10];
+        out.assign(DateUtils::formatDay(day + days, buf));
+        return true;
+    }
+
+    bool parseTerm(string_view text, Node& out, bool& isTerm) {
+        size_t opPos = text.find_first_of(":<>=!");
+        if (opPos == string_view::npos) {
+            out = Node(Node::TEXT, lower(text));
+            return true;
+        }
+        string field = lower(text.substr(0, opPos));
+        size_t opLen = opPos + 1 < text.size() && text[opPos + 1] == '=' ? 2 : 1;
+        string_view op = text.substr(opPos, opLen);
+        string_view value = text.substr(opPos + opLen);
+        if (op == ":" || op == "==") op = "=";
+        if (value.empty()) return fail("missing value for '" + field + "'");
+
+        // field!=value is not(field=value)
+        if (op == "!=") {
+            out = Node(Node::NOT);
+            out.children.emplace_back();
+            return parseComparison(field, "=", value, out.children[0], isTerm);
+        }
+        return parseComparison(field, op, value, out, isTerm);
+    }
+
+    bool parseComparison(const string& field, string_view op, string_view value, Node& out, bool& isTerm) {
+        if (field == "sort") {
+            if (op != "=") return fail("use sort:key");
+            descending = value[0] == '-';
+            string key = lower(descending ? value.substr(1) : value);
+            if (key == "due") sortKey = DUE;
+            else if (key == "priority") sortKey = PRIORITY;
+            else if (key == "category") sortKey = CATEGORY;
+            else if (key == "description") sortKey = DESCRIPTION;
+            else if (key == "position") sortKey = POSITION;
+            else return fail("unknown sort key '" + key + "'");
+            isTerm = false;
+            return true;
+        }
+        if (field == "category") {
+            if (op != "=") return fail("category supports : and != only");
+            out = Node(Node::CATEGORY, string(value));
+            return true;
+        }
+        if (field == "status") {
+            string status = lower(value);
+            if (op != "=") return fail("status supports : and != only");
+            if (status != "completed" && status != "pending" && status != "overdue") {
+                return fail("status must be completed, pending or overdue");
+            }
+            out = Node(Node::STATUS, status);
+            return true;
+        }
+        if (field == "text" || field == "description") {
+            if (op != "=") return fail("text supports : and != only");
+            out = Node(Node::TEXT, lower(value));
+            return true;
+        }
+        if (field == "priority") {
+            int number = StringUtils::toInt(value, -1);
+            if (number < 1 || number > 3) return fail("priority must be 1-3");
+            out = Node(Node::PRIORITY);
+            if (op == "=") out.low = out.high = number;
+            else if (op == "<") out.high = number - 1;
+            else if (op == "<=") out.high = number;
+            else if (op == ">") out.low = number + 1;
+            else if (op == ">=") out.low = number;
+            return true;
+        }
+        if (field == "due") {
+            out = Node(Node::DUE);
+            size_t dots = value.find("..");
+            if (op == "=" && dots != string_view::npos) {
+                string_view first = value.substr(0, dots), last = value.substr(dots + 2);
+                if ((!first.empty() && !shiftDate(first, 0, out.from)) || (!last.empty() && !shiftDate(last, 0, out.to))) {
+                    return fail("due range must be YYYY-MM-DD..YYYY-MM-DD");
+                }
+                return true;
+            }
+            bool ok = true;
+            if (op == "=") ok = shiftDate(value, 0, out.from) && shiftDate(value, 0, out.to);
+            else if (op == "<") ok = shiftDate(value, -1, out.to);
+            else if (op == "<=") ok = shiftDate(value, 0, out.to);
+            else if (op == ">") ok = shiftDate(value, 1, out.from);
+            else if (op == ">=") ok = shiftDate(value, 0, out.from);
+            if (!ok) return fail("due date must be YYYY-MM-DD");
+            return true;
+        }
+        return fail("unknown field '" + field + "'");
+    }
+
+public:
+    bool parse(string_view text, string& message) {
+        rootNode = Node(Node::AND);
+        sortKey = POSITION;
+        descending = false;
+        pos = 0;
+        error.clear();
+        bool ok = tokenize(text) && parseOr(rootNode);
+        if (ok && pos < tokens.size()) ok = fail("unexpected '" + tokens[pos].text + "'");
+        tokens.clear();
+        message = error;
+        return ok;
+    }
+
+    const Node& root() const { return rootNode; }
+
+    static bool matches(const Node& node, const Task& task, string_view today) {
+        switch (node.kind) {
+            case Node::AND:
+                for (const auto& child : node.children) {
+                    if (!matches(child, task, today)) return false;
+                }
+                return true;
+            case Node::OR:
+                for (const auto& child : node.children) {
+                    if (matches(child, task, today)) return true;
+                }
+                return false;
+            case Node::NOT:
+                return !matches(node.children[0], task, today);
+            case Node::CATEGORY:
+                return task.getCategory() == node.value;
+            case Node::PRIORITY:
+                return task.getPriority() >= node.low && task.getPriority() <= node.high;
+            case Node::DUE:
+                return (node.from.empty() || task.getDueDate() >= node.from)
+                    && (node.to.empty() || task.getDueDate() <= node.to);
+            case Node::STATUS:
+                if (node.value == "completed") return task.getIsCompleted();
+                if (node.value == "overdue") return task.isOverdue(today);
+                return !task.getIsCompleted() && !task.isOverdue(today);
+            case Node::TEXT:
+                return StringUtils::containsIgnoreCase(task.getDescription(), node.value);
+        }
+        return false;
+    }
+
+    bool matches(const Task& task, string_view today) const {
+        return matches(rootNode, task, today);
+    }
+
+    // Orders result positions by the requested key; ties keep list order
+    template <class Tasks>
+    void sortResults(vector<int>& results, const Tasks& tasks) const {
+        if (sortKey == POSITION) {
+            if (descending) reverse(results.begin(), results.end());
+            return;
+        }
+        auto key = [&](int a, int b) {
+            const Task& x = tasks[a];
+            const Task& y = tasks[b];
+            switch (sortKey) {
+                case DUE: return x.getDueDate().compare(y.getDueDate());
+                case PRIORITY: return x.getPriority() - y.getPriority();
+                case CATEGORY: return x.getCategory().compare(y.getCategory());
+                default: return x.getDescription().compare(y.getDescription());
+            }
+        };
+        stable_sort(results.begin(), results.end(), [&](int a, int b) {
+            int order = key(a, b);
+            return descending ? order > 0 : order < 0;
+        });
+    }
+};
+
+// Memory resource that forwards to another one and keeps a running total of
+// the bytes currently handed out, used to measure what a session arena costs
+class CountingResource : public pmr::memory_resource {
+private:
+    pmr::memory_resource* upstream;
+    atomic<size_t> inUse{0};
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* p = upstream->allocate(bytes, alignment);
+        inUse += bytes;
+        return p;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        upstream->deallocate(p, bytes, alignment);
+        inUse -= bytes;
+    }
+
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    explicit CountingResource(pmr::memory_resource* next = pmr::new_delete_resource()) : upstream(next) {}
+    CountingResource(const CountingResource&) = delete;
+    CountingResource& operator=(const CountingResource&) = delete;
+
+    size_t bytesInUse() const { return inUse; }
+};
+
+// Secondary indexes over the live tasks of a TaskStore. Each group records
+// the store generation it was built for and is rebuilt on first use after
+// any mutation; the vectors keep their capacity between rebuilds.
+class TaskIndex {
+private:
+    uint64_t fieldsGeneration = UINT64_MAX;
+    uint64_t textGeneration = UINT64_MAX;
+    CountingResource memory; // everything the indexes below allocate
+
+public:
+    using Positions = pmr::vector<uint32_t>;
+
+    pmr::map<pmr::string, Positions, less<>> byCategory{&memory};
+    Positions byPriority[4] = {Positions(&memory), Positions(&memory), Positions(&memory), Positions(&memory)};
+    Positions byDue{&memory}; // positions ordered by due date
+    pmr::unordered_map<uint32_t, Positions> byTrigram{&memory}; // description trigrams
+
+    size_t memoryBytes() const { return memory.bytesInUse(); }
+
+    static uint32_t trigram(const char* text) {
+        auto lowerByte = [](char c) { return (uint32_t)(unsigned char)tolower((unsigned char)c); };
+        return lowerByte(text[0]) << 16 | lowerByte(text[1]) << 8 | lowerByte(text[2]);
+    }
+
+    static int priorityBucket(int priority) { return priority >= 1 && priority <= 3 ? priority : 0; }
+
+    // Marks the indexes stale and hands their memory back
+    void invalidate() {
+        fieldsGeneration = textGeneration = UINT64_MAX;
+        byCategory.clear();
+        for (auto& positions : byPriority) Positions(&memory).swap(positions);
+        Positions(&memory).swap(byDue);
+        byTrigram = pmr::unordered_map<uint32_t, Positions>(&memory);
+    }
+
+    template <class Tasks>
+    void ensureFields(const Tasks& tasks, uint64_t generation) {
+        if (fieldsGeneration == generation) return;
+        TRACE_SPAN("index fields");
+        for (auto& [category, positions] : byCategory) positions.clear();
+        for (auto& positions : byPriority) positions.clear();
+        byDue.clear();
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            const Task& task = tasks[i];
+            if (task.getIsDeleted()) continue;
+            auto it = byCategory.find(task.getCategory());
+            if (it == byCategory.end()) it = byCategory.emplace(task.getCategory(), Positions()).first;
+            it->second.push_back((uint32_t)i);
+            byPriority[priorityBucket(task.getPriority())].push_back((uint32_t)i);
+            byDue.push_back((uint32_t)i);
+        }
+        stable_sort(byDue.begin(), byDue.end(), [&](uint32_t a, uint32_t b) {
+            return tasks[a].getDueDate() < tasks[b].getDueDate();
+        });
+        fieldsGeneration = generation;
+    }
+
+    template <class Tasks>
+    void ensureText(const Tasks& tasks, uint64_t generation) {
+        if (textGeneration == generation) return;
+        TRACE_SPAN("index text");
+        for (auto& [key, positions] : byTrigram) positions.clear();
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if (tasks[i].getIsDeleted()) continue;
+            string_view text = tasks[i].getDescription();
+            for (size_t at = 0; at + 3 <= text.size(); ++at) {
+                Positions& positions = byTrigram[trigram(text.data() + at)];
+                if (positions.empty() || positions.back() != (uint32_t)i) positions.push_back((uint32_t)i);
+            }
+        }
+        textGeneration = generation;
+    }
+};
+
+// Fixed-size worker pool used by the parallel load/scan paths
+class ThreadPool {
+private:
+    vector<thread> workers;
+    queue<function<void()>> jobs;
+    mutex jobsMutex;
+    condition_variable jobsReady;
+    bool stopping = false;
+
+    void workerLoop() {
+        while (true) {
+            function<void()> job;
+            {
+                unique_lock<mutex> lock(jobsMutex);
+                jobsReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop();
+            }
+            job();
+        }
+    }
+
+public:
+    explicit ThreadPool(unsigned threadCount) {
+        for (unsigned i = 0; i < max(1u, threadCount); ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(jobsMutex);
+            stopping = true;
+        }
+        jobsReady.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return (unsigned)workers.size(); }
+
+    template <class F>
+    future<void> submit(F job) {
+        auto packaged = make_shared<packaged_task<void()>>(std::move(job));
+        future<void> done = packaged->get_future();
+        {
+            lock_guard<mutex> lock(jobsMutex);
+            jobs.emplace([packaged] { (*packaged)(); });
+        }
+        jobsReady.notify_one();
+        return done;
+    }
+
+    // Runs body(i) for every i in [0, count) on the pool and waits for all of
+    // them; exceptions thrown by a body are rethrown here
+    template <class F>
+    void parallelFor(size_t count, F body) {
+        if (count == 0) return;
+        if (count == 1) {
+            body(size_t(0));
+            return;
+        }
+        atomic<size_t> next{0};
+        vector<future<void>> running;
+        size_t helpers = min<size_t>(count, workers.size());
+        for (size_t h = 0; h < helpers; ++h) {
+            running.push_back(submit([&] {
+                for (size_t i = next++; i < count; i = next++) body(i);
+            }));
+        }
+        for (auto& f : running) f.get();
+    }
+};
+
+// Predicate scan over the task list. Lists above the threshold are split into
+// contiguous partitions evaluated on the pool, each into its own result buffer;
+// the buffers are concatenated in partition order so results stay sorted.
+class ParallelScan {
+public:
+    static constexpr size_t SEQUENTIAL_THRESHOLD = 32 * 1024;
+
+    template <class Pred>
+    static vector<int> sequential(const pmr::vector<Task>& tasks, Pred pred) {
+        vector<int> results;
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if (pred(tasks[i])) results.push_back((int)i);
+        }
+        return results;
+    }
+
+    template <class Pred>
+    static vector<int> run(const pmr::vector<Task>& tasks, ThreadPool& pool, Pred pred) {
+        vector<vector<int>> partial = reduce<vector<int>>(tasks, pool, [&](vector<int>& hits, size_t i) {
+            if (pred(tasks[i])) hits.push_back((int)i);
+        });
+
+        size_t total = 0;
+        for (const auto& hits : partial) total += hits.size();
+        vector<int> results;
+        results.reserve(total);
+        for (const auto& hits : partial) results.insert(results.end(), hits.begin(), hits.end());
+        return results;
+    }
+
+    // Folds every index of each partition into that partition's Partial with
+    // fold(partial, index); the caller combines the returned partials
+    template <class Partial, class Fold>
+    static vector<Partial> reduce(const pmr::vector<Task>& tasks, ThreadPool& pool, Fold fold) {
+        size_t partitions = min<size_t>((size_t)pool.size() * 4, tasks.size() / 1024 + 1);
+        size_t step = (tasks.size() + partitions - 1) / partitions;
+        vector<Partial> partial(partitions);
+
+        pool.parallelFor(partitions, [&](size_t p) {
+            size_t begin = p * step, end = min(tasks.size(), begin + step);
+            for (size_t i = begin; i < end; ++i) fold(partial[p], i);
+        });
+        return partial;
+    }
+};
+
+// One parsed line of a task file; the views point into the file buffer
+struct TaskRecord {
+    uint64_t id;
+    string_view description;
+    bool isCompleted;
+    int priority;
+    string_view dueDate;
+    string_view category;
+    RecurrenceRule recurrence;
+    int32_t completedDay = Task::NO_DAY;
+};
+
+// Utility class for reading the pipe-delimited task file format
+class TaskFile {
+public:
+    static constexpr const char* MAGIC = "#TaskReaper";
+    static constexpr int VERSION = 4; // 3: done field may hold the completion date; 4: summary block
+    static constexpr const char* SUMMARY_TAG = "#Summary";
+    static constexpr const char* DUE_TAG = "#Due";
+    static constexpr size_t SUMMARY_TASKS = 10; // pending tasks listed in the summary block
+
+    // Block save() writes after the header line:
+    //   #Summary|total|completed|pending
+    //   #Due|id|due|priority|description   (the pending tasks due soonest)
+    // so a login can show counts and reminders before the full load
+    struct Summary {
+        struct Upcoming {
+            uint64_t id;
+            string dueDate;
+            int priority;
+            string description;
+        };
+        bool present = false;
+        size_t total = 0, completed = 0, pending = 0;
+        vector<Upcoming> upcoming; // earliest due first
+    };
+
+    static bool readAll(const string& filename, string& out) {
+        TRACE_SPAN("read file", filename);
+        ifstream file(filename, ios::binary);
+        if (!file.is_open()) return false;
+        file.seekg(0, ios::end);
+        out.resize((size_t)file.tellg());
+        file.seekg(0, ios::beg);
+        file.read(out.data(), (streamsize)out.size());
+        return true;
+    }
+
+    // Consumes the header line and summary block if present and returns the
+    // stored next id (0 if none)
+    static uint64_t readHeader(string_view& text) {
+        if (text.substr(0, char_traits<char>::length(MAGIC)) != MAGIC) return 0;
+        size_t eol = text.find('\n');
+        string_view fields[3];
+        uint64_t nextId = 0;
+        if (StringUtils::split(text.substr(0, eol), '|', fields, 3) >= 3) {
+            nextId = StringUtils::toU64(fields[2]);
+        }
+        text.remove_prefix(eol == string_view::npos ? text.size() : eol + 1);
+        while (!text.empty() && text[0] == '#') {
+            eol = text.find('\n');
+            text.remove_prefix(eol == string_view::npos ? text.size() : eol + 1);
+        }
+        return nextId;
+    }
+
+    // Reads only the header and summary block, however long the file is.
+    // Returns false if the file has no summary (missing, or saved before
+    // version 4).
+    static bool readSummary(const string& filename, Summary& out) {
+        TRACE_SPAN("read summary", filename);
+        out = Summary();
+        ifstream file(filename);
+        string line;
+        if (!getline(file, line) || line.compare(0, char_traits<char>::length(MAGIC), MAGIC) != 0) return false;
+        while (getline(file, line) && !line.empty() && line[0] == '#') {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            string_view fields[5];
+            size_t count = StringUtils::split(line, '|', fields, 5);
+            if (fields[0] == SUMMARY_TAG && count >= 4) {
+                out.present = true;
+                out.total = StringUtils::toU64(fields[1]);
+                out.completed = StringUtils::toU64(fields[2]);
+                out.pending = StringUtils::toU64(fields[3]);
+            } else if (fields[0] == DUE_TAG && count >= 5) {
+                out.upcoming.push_back({StringUtils::toU64(fields[1]), string(fields[2]),
+                                        StringUtils::toInt(fields[3]), string(fields[4])});
+            }
+        }
+        return out.present;
+    }
+
+    // Fields: id|description|done|priority|due|category|recurring|frequency,
+    // then for recurring tasks |interval|until|start. Lines written before the
+    // rule fields existed anchor their series at the current due date. done
+    // is 0, 1, or the date a completed task was completed on.
+    static bool parseLine(string_view line, TaskRecord& out) {
+        if (!line.empty() && line[0] == '#') return false;
+        string_view tokens[11];
+        size_t count = StringUtils::split(line, '|', tokens, 11);
+        if (count < 6) return false;
+
+        out.id = StringUtils::toU64(tokens[0]);
+        out.description = tokens[1];
+        out.completedDay = Task::NO_DAY;
+        out.isCompleted = tokens[2] == "1" || DateUtils::toDayNumber(tokens[2], out.completedDay);
+        out.priority = StringUtils::toInt(tokens[3]);
+        out.dueDate = tokens[4];
+        out.category = tokens[5];
+        out.recurrence = RecurrenceRule();
+        if (count >= 8 && tokens[6] == "1") {
+            RecurrenceRule& rule = out.recurrence;
+            rule.frequency = RecurrenceRule::parseFrequency(tokens[7]);
+            if (count >= 9) rule.interval = (uint16_t)clamp(StringUtils::toInt(tokens[8], 1), 1, 65535);
+            if (count >= 10) DateUtils::toDayNumber(tokens[9], rule.untilDay);
+            if (count < 11 || !DateUtils::toDayNumber(tokens[10], rule.startDay)) {
+                DateUtils::toDayNumber(out.dueDate, rule.startDay);
+            }
+        }
+        return true;
+    }
+
+    // Calls fn(record) for each task line in chunk, reusing one record
+    template <class Fn>
+    static void forEachRecord(string_view chunk, Fn fn) {
+        TaskRecord record;
+        while (!chunk.empty()) {
+            size_t eol = chunk.find('\n');
+            string_view line = chunk.substr(0, eol);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (parseLine(line, record)) fn(record);
+            chunk.remove_prefix(eol == string_view::npos ? chunk.size() : eol + 1);
+        }
+    }
+
+    static void parseChunk(string_view chunk, vector<TaskRecord>& out) {
+        TRACE_SPAN("parse");
+        forEachRecord(chunk, [&](const TaskRecord& record) { out.push_back(record); });
+    }
+
+    // Cuts text into roughly equal pieces, moving each cut forward to the
+    // next newline so no line straddles two pieces
+    static vector<string_view> splitAtLines(string_view text, size_t pieces) {
+        vector<string_view> chunks;
+        size_t target = text.size() / max<size_t>(1, pieces) + 1;
+        while (!text.empty()) {
+            size_t cut = text.size() <= target ? string_view::npos : text.find('\n', target);
+            size_t len = cut == string_view::npos ? text.size() : cut + 1;
+            chunks.push_back(text.substr(0, len));
+            text.remove_prefix(len);
+        }
+        return chunks;
+    }
+};
+
+// Status/priority/category counts. Workers fill a StatsPartial whose category
+// keys are views into task storage; merging into TaskStats copies the keys,
+// so the partial can be dropped once its source buffer goes away.
+struct StatsPartial {
+    size_t total = 0, completed = 0, pending = 0, overdue = 0;
+    size_t high = 0, medium = 0, low = 0;
+    unordered_map<string_view, size_t> categories;
+
+    void add(bool isCompleted, bool isOverdue, int priority, string_view category) {
+        total++;
+        if (isCompleted) completed++;
+        else if (isOverdue) overdue++;
+        else pending++;
+
+        switch (priority) {
+            case 1: high++; break;
+            case 2: medium++; break;
+            case 3: low++; break;
+        }
+
+        categories[category]++;
+    }
+
+    void add(const Task& task, string_view today) {
+        add(task.getIsCompleted(), task.isOverdue(today), task.getPriority(), task.getCategory());
+    }
+
+    void add(const TaskRecord& record, string_view today) {
+        add(record.isCompleted, !record.isCompleted && record.dueDate < today, record.priority, record.category);
+    }
+};
+
+struct TaskStats {
+    size_t total = 0, completed = 0, pending = 0, overdue = 0;
+    size_t high = 0, medium = 0, low = 0;
+    map<string, size_t, less<>> categories;
+
+    template <class Partial>
+    void mergeCounts(const Partial& other) {
+        total += other.total;
+        completed += other.completed;
+        pending += other.pending;
+        overdue += other.overdue;
+        high += other.high;
+        medium += other.medium;
+        low += other.low;
+    }
+
+    void merge(const StatsPartial& partial) {
+        mergeCounts(partial);
+        for (const auto& pair : partial.categories) {
+            auto it = categories.find(pair.first);
+            if (it == categories.end()) it = categories.emplace(string(pair.first), 0).first;
+            it->second += pair.second;
+        }
+    }
+
+    void merge(const TaskStats& other) {
+        mergeCounts(other);
+        for (const auto& pair : other.categories) categories[pair.first] += pair.second;
+    }
+
+    void print() const {
+        cout << "Total Tasks: " << total << "\n";
+        cout << "Completed: " << completed << " (" << (total ? completed * 100 / total : 0) << "%)\n";
+        cout << "Pending: " << pending << "\n";
+        cout << "Overdue: " << overdue << "\n\n";
+
+        cout << "Priority Distribution:\n";
+        cout << "High: " << high << ", Medium: " << medium << ", Low: " << low << "\n\n";
+
+        cout << "Tasks by Category:\n";
+        for (const auto& pair : categories) {
+            cout << pair.first << ": " << pair.second << "\n";
+        }
+    }
+};
+
+// Latency histogram with HDR-style log-linear buckets: values under 16 ns are
+// exact and every power of two above is split into 16 sub-buckets, so any
+// percentile is reported to within 1/16 of the true value over the whole
+// 64-bit range. Counters are relaxed atomics; recording takes no lock and can
+// happen on any thread.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int BUCKETS = SUB_BUCKETS * (64 - SUB_BITS + 1);
+
+    struct Summary {
+        uint64_t count, p50, p99, p999, max, mean; // in the recorded unit, nanoseconds for timings
+    };
+
+private:
+    atomic<uint64_t> counts[BUCKETS] = {};
+    atomic<uint64_t> total{0}, sum{0}, largest{0};
+
+    static int bucketOf(uint64_t value) {
+        if (value < SUB_BUCKETS) return (int)value;
+        int shift = 63 - countl_zero(value) - SUB_BITS;
+        return SUB_BUCKETS * (shift + 1) + (int)((value >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    // Largest value that falls in bucket
+    static uint64_t upperBound(int bucket) {
+        if (bucket < SUB_BUCKETS) return (uint64_t)bucket;
+        int shift = bucket / SUB_BUCKETS - 1;
+        uint64_t leading = SUB_BUCKETS + bucket % SUB_BUCKETS;
+        return ((leading + 1) << shift) - 1;
+    }
+
+public:
+    void record(uint64_t nanoseconds) {
+        counts[bucketOf(nanoseconds)].fetch_add(1, memory_order_relaxed);
+        total.fetch_add(1, memory_order_relaxed);
+        sum.fetch_add(nanoseconds, memory_order_relaxed);
+        uint64_t seen = largest.load(memory_order_relaxed);
+        while (nanoseconds > seen && !largest.compare_exchange_weak(seen, nanoseconds, memory_order_relaxed)) {}
+    }
+
+    void reset() {
+        for (auto& count : counts) count.store(0, memory_order_relaxed);
+        total.store(0, memory_order_relaxed);
+        sum.store(0, memory_order_relaxed);
+        largest.store(0, memory_order_relaxed);
+    }
+
+    // Percentiles from one pass over the buckets. Recording may run
+    // concurrently, so the figures are approximate while it does.
+    Summary summary() const {
+        Summary result{};
+        result.max = largest.load(memory_order_relaxed);
+        uint64_t seen[BUCKETS];
+        for (int b = 0; b < BUCKETS; ++b) {
+            seen[b] = counts[b].load(memory_order_relaxed);
+            result.count += seen[b];
+        }
+        if (result.count == 0) return result;
+        result.mean = sum.load(memory_order_relaxed) / result.count;
+
+        uint64_t* targets[] = {&result.p50, &result.p99, &result.p999};
+        const uint64_t perMille[] = {500, 990, 999};
+        uint64_t cumulative = 0;
+        int next = 0;
+        for (int b = 0; b < BUCKETS && next < 3; ++b) {
+            cumulative += seen[b];
+            while (next < 3 && cumulative >= max<uint64_t>(1, (result.count * perMille[next] + 999) / 1000)) {
+                *targets[next++] = min(upperBound(b), result.max);
+            }
+        }
+        return result;
+    }
+};
+
+// Process-wide latency histograms, one per instrumented operation. Timings
+// cover the work itself, not prompts or console output.
+class Perf {
+public:
+    enum Operation {
+        LOAD, SAVE, SEARCH_DESCRIPTION, SEARCH_CATEGORY, SEARCH_PRIORITY, SEARCH_STATUS, QUERY,
+        SORT_BY_DUE, SORT_BY_PRIORITY, STATISTICS, REMINDERS, UNDO, JOURNAL_COMMIT, JOURNAL_SYNC,
+        SNAPSHOT_START, SNAPSHOT, IO_BATCH, OPERATION_COUNT
+    };
+
+    static const char* name(Operation op) {
+        static const char* names[] = {
+            "load", "save", "search_description", "search_category", "search_priority", "search_status", "query",
+            "sort_by_due", "sort_by_priority", "statistics", "reminders", "undo", "journal_commit", "journal_sync",
+            "snapshot_start", "snapshot", "io_batch",
+        };
+        return names[op];
+    }
+
+    static LatencyHistogram& histogram(Operation op) {
+        static LatencyHistogram histograms[OPERATION_COUNT];
+        return histograms[op];
+    }
+
+    // Records per journal write. Not a duration, so it is kept apart from the
+    // operation histograms.
+    static LatencyHistogram& journalBatches() {
+        static LatencyHistogram batches;
+        return batches;
+    }
+
+    static void reset() {
+        for (int op = 0; op < OPERATION_COUNT; ++op) histogram((Operation)op).reset();
+        journalBatches().reset();
+    }
+
+    // Records the time from construction to stop() or destruction
+    class Timer {
+    private:
+        Operation op;
+        chrono::steady_clock::time_point start;
+        bool running = true;
+
+    public:
+        explicit Timer(Operation operation) : op(operation), start(chrono::steady_clock::now()) {}
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+        ~Timer() { stop(); }
+
+        void stop() {
+            if (!running) return;
+            running = false;
+            auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+            histogram(op).record((uint64_t)elapsed.count());
+        }
+    };
+
+    // Human-readable duration: ns, us, ms or s with three significant digits
+    static string formatDuration(uint64_t nanoseconds) {
+        static const char* units[] = {"ns", "us", "ms", "s"};
+        double value = (double)nanoseconds;
+        int unit = 0;
+        while (value >= 1000 && unit < 3) {
+            value /= 1000;
+            unit++;
+        }
+        ostringstream out;
+        out << setprecision(value < 10 && unit > 0 ? 2 : 3) << value << units[unit];
+        return out.str();
+    }
+
+    // Table of operations that have been timed at least once
+    static void print(ostream& out) {
+        out << left << setw(20) << "Operation" << right << setw(8) << "Count" << setw(10) << "p50"
+            << setw(10) << "p99" << setw(10) << "p99.9" << setw(10) << "Max" << "\n";
+        for (int op = 0; op < OPERATION_COUNT; ++op) {
+            LatencyHistogram::Summary s = histogram((Operation)op).summary();
+            if (s.count == 0) continue;
+            out << left << setw(20) << name((Operation)op) << right << setw(8) << s.count
+                << setw(10) << formatDuration(s.p50) << setw(10) << formatDuration(s.p99)
+                << setw(10) << formatDuration(s.p999) << setw(10) << formatDuration(s.max) << "\n";
+        }
+        LatencyHistogram::Summary batches = journalBatches().summary();
+        if (batches.count > 0) {
+            out << "Journal writes: " << batches.count << ", records per write p50 " << batches.p50 << ", p99 "
+                << batches.p99 << ", max " << batches.max << ", mean " << batches.mean << "\n";
+        }
+    }
+
+    // One JSON object keyed by operation name, all figures in nanoseconds
+    static void writeJson(ostream& out) {
+        out << "{\"unit\":\"ns\",\"operations\":{";
+        for (int op = 0; op < OPERATION_COUNT; ++op) {
+            LatencyHistogram::Summary s = histogram((Operation)op).summary();
+            out << (op ? "," : "") << "\"" << name((Operation)op) << "\":{\"count\":" << s.count
+                << ",\"p50\":" << s.p50 << ",\"p99\":" << s.p99 << ",\"p999\":" << s.p999
+                << ",\"max\":" << s.max << ",\"mean\":" << s.mean << "}";
+        }
+        LatencyHistogram::Summary b = journalBatches().summary();
+        out << "},\"journal_batch_records\":{\"count\":" << b.count << ",\"p50\":" << b.p50 << ",\"p99\":" << b.p99
+            << ",\"p999\":" << b.p999 << ",\"max\":" << b.max << ",\"mean\":" << b.mean << "}}";
+    }
+};
+
+// Per-day activity for one user: tasks created and completed each day, and
+// the overdue count seen on days the list was saved. Counters are kept
+// densely from the first recorded day with a Fenwick tree over each, so the
+// total for any span of days is two prefix-sum lookups however many years of
+// history there are, and a mutation updates them in O(log days).
+class TrendCounters {
+public:
+    enum Counter { CREATED, COMPLETED };
+    static constexpr int32_t NO_SAMPLE = -1;
+    static constexpr const char* MAGIC = "#TaskReaperTrends";
+
+private:
+    int32_t firstDay = 0;
+    vector<int32_t> daily[2];
+    vector<int64_t> sums[2]; // Fenwick trees over daily, 1-based
+    vector<int32_t> overdue; // NO_SAMPLE where the day wasn't observed
+
+    size_t days() const { return overdue.size(); }
+
+    void rebuild() {
+        for (int c = 0; c < 2; ++c) {
+            sums[c].assign(days() + 1, 0);
+            for (size_t i = 1; i <= days(); ++i) {
+                sums[c][i] += daily[c][i - 1];
+                size_t parent = i + (i & -i);
+                if (parent <= days()) sums[c][parent] += sums[c][i];
+            }
+        }
+    }
+
+    // Widens the covered span to include day; returns its slot
+    size_t cover(int32_t day) {
+        if (days() == 0) {
+            firstDay = day;
+        } else if (day < firstDay) {
+            size_t grow = (size_t)(firstDay - day);
+            for (auto& counts : daily) counts.insert(counts.begin(), grow, 0);
+            overdue.insert(overdue.begin(), grow, NO_SAMPLE);
+            firstDay = day;
+            rebuild();
+            return 0;
+        }
+        size_t slot = (size_t)(day - firstDay);
+        if (slot >= days()) {
+            for (auto& counts : daily) counts.resize(slot + 1, 0);
+            overdue.resize(slot + 1, NO_SAMPLE);
+            rebuild();
+        }
+        return slot;
+    }
+
+    // Sum of counter over slots [0, count)
+    int64_t prefix(Counter counter, size_t count) const {
+        int64_t total = 0;
+        for (size_t i = min(count, days()); i > 0; i -= i & -i) total += sums[counter][i];
+        return total;
+    }
+
+public:
+    bool empty() const { return days() == 0; }
+
+    size_t memoryBytes() const {
+        size_t bytes = overdue.capacity() * sizeof(int32_t);
+        for (int c = 0; c < 2; ++c) bytes += daily[c].capacity() * sizeof(int32_t) + sums[c].capacity() * sizeof(int64_t);
+        return bytes;
+    }
+
+    void clear() {
+        for (auto& counts : daily) counts.clear();
+        for (auto& tree : sums) tree.clear();
+        overdue.clear();
+    }
+
+    // Adds delta to counter on day. Takebacks (undo) never drive a day below zero.
+    void record(Counter counter, int32_t day, int delta = 1) {
+        if (day == Task::NO_DAY) return;
+        size_t slot = cover(day);
+        if (delta < 0 && daily[counter][slot] < -delta) return;
+        daily[counter][slot] += delta;
+        for (size_t i = slot + 1; i <= days(); i += i & -i) sums[counter][i] += delta;
+    }
+
+    void sampleOverdue(int32_t day, int32_t count) { overdue[cover(day)] = count; }
+
+    int32_t on(Counter counter, int32_t day) const {
+        if (day < firstDay || day >= firstDay + (int32_t)days()) return 0;
+        return daily[counter][day - firstDay];
+    }
+
+    int32_t overdueOn(int32_t day) const {
+        if (day < firstDay || day >= firstDay + (int32_t)days()) return NO_SAMPLE;
+        return overdue[day - firstDay];
+    }
+
+    // Latest overdue sample in [from, to], or NO_SAMPLE
+    int32_t lastOverdue(int32_t from, int32_t to) const {
+        for (int32_t day = to; day >= from; --day) {
+            if (overdueOn(day) != NO_SAMPLE) return overdueOn(day);
+            if (day < firstDay) break;
+        }
+        return NO_SAMPLE;
+    }
+
+    // Total of counter over the days from..to inclusive
+    int64_t total(Counter counter, int32_t from, int32_t to) const {
+        if (empty() || to < from) return 0;
+        int64_t lo = max<int64_t>(0, (int64_t)from - firstDay);
+        int64_t hi = min<int64_t>((int64_t)days(), (int64_t)to - firstDay + 1);
+        if (hi <= lo) return 0;
+        return prefix(counter, (size_t)hi) - prefix(counter, (size_t)lo);
+    }
+
+    // Consecutive days with a completion, ending today, or yesterday if
+    // nothing has been completed yet today
+    int streak(int32_t today) const {
+        int32_t day = on(COMPLETED, today) > 0 ? today : today - 1;
+        int length = 0;
+        while (on(COMPLETED, day) > 0) {
+            length++;
+            day--;
+        }
+        return length;
+    }
+
+    int longestStreak() const {
+        int best = 0, run = 0;
+        for (int32_t count : daily[COMPLETED]) {
+            run = count > 0 ? run + 1 : 0;
+            best = max(best, run);
+        }
+        return best;
+    }
+
+    // Sidecar format: a header line, then day|created|completed|overdue for
+    // each day with anything recorded (overdue empty when not sampled)
+    void write(ostream& out) const {
+        out << MAGIC << "|1\n";
+        char date[10];
+        for (size_t i = 0; i < days(); ++i) {
+            if (!daily[CREATED][i] && !daily[COMPLETED][i] && overdue[i] == NO_SAMPLE) continue;
+            out << DateUtils::formatDay(firstDay + (int32_t)i, date) << "|" << daily[CREATED][i] << "|"
+                << daily[COMPLETED][i] << "|";
+            if (overdue[i] != NO_SAMPLE) out << overdue[i];
+            out << "\n";
+        }
+    }
+
+    void read(string_view text) {
+        clear();
+        if (text.substr(0, char_traits<char>::length(MAGIC)) != MAGIC) return;
+        vector<int32_t> dates, values[3];
+        while (!text.empty()) {
+            size_t eol = text.find('\n');
+            string_view line = text.substr(0, eol);
+            text.remove_prefix(eol == string_view::npos ? text.size() : eol + 1);
+            string_view fields[4];
+            int32_t day;
+            if (StringUtils::split(line, '|', fields, 4) < 4 || !DateUtils::toDayNumber(fields[0], day)) continue;
+            dates.push_back(day);
+            values[0].push_back(max(0, StringUtils::toInt(fields[1])));
+            values[1].push_back(max(0, StringUtils::toInt(fields[2])));
+            values[2].push_back(fields[3].empty() ? NO_SAMPLE : StringUtils::toInt(fields[3], NO_SAMPLE));
+        }
+        if (dates.empty()) return;
+
+        // Fill the dense arrays first and build the trees once
+        firstDay = *min_element(dates.begin(), dates.end());
+        size_t span = (size_t)(*max_element(dates.begin(), dates.end()) - firstDay) + 1;
+        for (auto& counts : daily) counts.assign(span, 0);
+        overdue.assign(span, NO_SAMPLE);
+        for (size_t i = 0; i < dates.size(); ++i) {
+            size_t slot = (size_t)(dates[i] - firstDay);
+            daily[CREATED][slot] += values[0][i];
+            daily[COMPLETED][slot] += values[1][i];
+            if (values[2][i] != NO_SAMPLE) overdue[slot] = values[2][i];
+        }
+        rebuild();
+    }
+};
+
+// Batched file I/O for work that touches many files at once: the group-commit
+// thread syncing several journals, the server writing back every dirty list,
+// and the all-users report and export reading every task file. A batch is
+// handed over whole and run() returns once every operation in it is done.
+//
+// With io_uring (Linux, built with TASKREAPER_IO_URING) the calling thread
+// keeps the whole batch in flight in its own ring: each file's open, reads
+// or writes, fdatasync and close are queued one after another as the
+// previous step completes, and a single io_uring_enter submits the next
+// steps and waits for more results. Otherwise, or when the kernel refuses a
+// ring, the operations run as blocking calls on a small thread pool.
+class AsyncIo {
+public:
+    enum Kind { READ_FILE, WRITE_FILE, APPEND };
+    enum Backend { AUTO, URING, THREADS };
+
+    struct Op {
+        Kind kind = READ_FILE;
+        string path;            // READ_FILE, WRITE_FILE (created or truncated)
+        FILE* stream = nullptr; // APPEND: an open stream with nothing buffered
+        string_view data;       // WRITE_FILE, APPEND
+        bool sync = false;      // WRITE_FILE, APPEND: fdatasync once written
+        string contents;        // READ_FILE: what the file holds
+        bool ok = false;
+        int error = 0;          // errno of the step that failed
+
+        static Op read(string path) {
+            Op op;
+            op.path = std::move(path);
+            return op;
+        }
+
+        static Op write(string path, string_view data, bool sync) {
+            Op op;
+            op.kind = WRITE_FILE;
+            op.path = std::move(path);
+            op.data = data;
+            op.sync = sync;
+            return op;
+        }
+
+        static Op append(FILE* stream, string_view data, bool sync) {
+            Op op;
+            op.kind = APPEND;
+            op.stream = stream;
+            op.data = data;
+            op.sync = sync;
+            return op;
+        }
+    };
+
+    static constexpr unsigned RING_ENTRIES = 256; // operations in flight per ring
+    static constexpr unsigned POOL_THREADS = 8;   // the fallback's workers; they mostly wait on the disk
+
+    // Set once at startup, before the first batch
+    static Backend& backend() {
+        static Backend chosen = AUTO;
+        return chosen;
+    }
+
+    // Forces a stream's written data to disk
+    static bool syncFile(FILE* file) {
+#if defined(__linux__)
+        return fdatasync(fileno(file)) == 0;
+#elif defined(TASKREAPER_HAS_POSIX_IO)
+        return fsync(fileno(file)) == 0;
+#else
+        (void)file;
+        return true;
+#endif
+    }
+
+    static void run(vector<Op>& ops) {
+        if (ops.empty()) return;
+        Perf::Timer timer(Perf::IO_BATCH);
+        TRACE_SPAN("io batch", to_string(ops.size()));
+#ifdef TASKREAPER_HAS_IO_URING
+        if (Ring* ring = threadRing()) {
+            ring->run(ops);
+            return;
+        }
+#endif
+        pool().parallelFor(ops.size(), [&](size_t i) { runBlocking(ops[i]); });
+    }
+
+    // For the performance screen
+    static string describe() {
+#ifdef TASKREAPER_HAS_IO_URING
+        if (backend() != THREADS) {
+            if (uringError() == 0) return "io_uring, " + to_string(RING_ENTRIES) + " in flight per thread";
+            return "thread pool, " + to_string(POOL_THREADS) + " threads (io_uring unavailable: " +
+                   strerror(uringError()) + ")";
+        }
+#endif
+        return "thread pool, " + to_string(POOL_THREADS) + " threads";
+    }
+
+private:
+    static ThreadPool& pool() {
+        static ThreadPool threads(POOL_THREADS);
+        return threads;
+    }
+
+    static void runBlocking(Op& op) {
+        errno = 0;
+        if (op.kind == READ_FILE) {
+            op.ok = TaskFile::readAll(op.path, op.contents);
+        } else {
+            FILE* file = op.kind == APPEND ? op.stream : fopen(op.path.c_str(), "wb");
+            op.ok = file && fwrite(op.data.data(), 1, op.data.size(), file) == op.data.size() && fflush(file) == 0 &&
+                    (!op.sync || syncFile(file));
+            if (file && op.kind == WRITE_FILE && fclose(file) != 0) op.ok = false;
+        }
+        if (!op.ok) op.error = errno ? errno : EIO;
+    }
+
+#ifdef TASKREAPER_HAS_IO_URING
+    // errno from the first failed ring setup, or 0. Once a setup has
+    // failed, every thread uses the pool.
+    static int& uringError() {
+        static int error = 0;
+        return error;
+    }
+
+    // A submission/completion ring pair, driven through the raw syscalls.
+    // Every operation has at most one step in flight, so the completion ring
+    // (twice the size) cannot overflow.
+    class Ring {
+    private:
+        int fd = -1;
+        void* rings = MAP_FAILED;
+        size_t ringBytes = 0;
+        io_uring_sqe* sqes = (io_uring_sqe*)MAP_FAILED;
+        size_t sqeBytes = 0;
+        unsigned *sqHead = nullptr, *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr;
+        unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+        io_uring_cqe* cqes = nullptr;
+        unsigned tail = 0;      // our copy of the submission tail
+        unsigned submitted = 0; // how far the kernel has been told
+
+        enum Step { OPEN, TRANSFER, SYNC, CLOSE, DONE };
+        struct State {
+            Step step = OPEN;
+            int fd = -1;
+            size_t done = 0; // bytes read or written so far
+        };
+
+        template <class T>
+        T* at(uint32_t offset) {
+            return (T*)((char*)rings + offset);
+        }
+
+        io_uring_sqe* slot() {
+            unsigned index = tail & *sqMask;
+            sqArray[index] = index;
+            io_uring_sqe* sqe = &sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            tail++;
+            return sqe;
+        }
+
+        // Submits what has been queued and waits for at least `wait` completions
+        bool enter(unsigned wait) {
+            __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+            while (true) {
+                long result = syscall(__NR_io_uring_enter, fd, tail - submitted, wait, IORING_ENTER_GETEVENTS,
+                                      nullptr, 0);
+                if (result >= 0) {
+                    submitted += (unsigned)result;
+                    return true;
+                }
+                if (errno != EINTR && errno != EAGAIN && errno != EBUSY) return false;
+            }
+        }
+
+        // Queues the next step of ops[i]
+        void queueStep(Op& op, State& state, uint64_t i) {
+            io_uring_sqe* sqe = slot();
+            sqe->user_data = i;
+            switch (state.step) {
+                case OPEN:
+                    sqe->opcode = IORING_OP_OPENAT;
+                    sqe->fd = AT_FDCWD;
+                    sqe->addr = (uint64_t)op.path.c_str();
+                    sqe->open_flags = O_CLOEXEC | (op.kind == READ_FILE ? O_RDONLY : O_WRONLY | O_CREAT | O_TRUNC);
+                    sqe->len = 0644;
+                    break;
+                case TRANSFER:
+                    sqe->fd = state.fd;
+                    if (op.kind == READ_FILE) {
+                        sqe->opcode = IORING_OP_READ;
+                        sqe->addr = (uint64_t)(op.contents.data() + state.done);
+                        sqe->len = (uint32_t)min<size_t>(op.contents.size() - state.done, UINT32_MAX);
+                        sqe->off = state.done;
+                    } else {
+                        sqe->opcode = IORING_OP_WRITE;
+                        sqe->addr = (uint64_t)(op.data.data() + state.done);
+                        sqe->len = (uint32_t)min<size_t>(op.data.size() - state.done, UINT32_MAX);
+                        // Appends go at the stream's own position, like write()
+                        sqe->off = op.kind == APPEND ? (uint64_t)-1 : state.done;
+                    }
+                    break;
+                case SYNC:
+                    sqe->opcode = IORING_OP_FSYNC;
+                    sqe->fd = state.fd;
+                    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+                    break;
+                case CLOSE:
+                    sqe->opcode = IORING_OP_CLOSE;
+                    sqe->fd = state.fd;
+                    break;
+                case DONE:
+                    break;
+            }
+        }
+
+        // Moves an operation on after a completion with result `res`
+        static void finishStep(Op& op, State& state, int res) {
+            if (state.step == TRANSFER && res == 0 && op.kind != READ_FILE) res = -EIO; // a write that wrote nothing
+            if (res < 0 && state.step != CLOSE) {
+                op.error = -res;
+                state.step = state.fd >= 0 && op.kind != APPEND ? CLOSE : DONE;
+                return;
+            }
+            size_t total = op.kind == READ_FILE ? op.contents.size() : op.data.size();
+            switch (state.step) {
+                case OPEN: {
+                    state.fd = res;
+                    if (op.kind == READ_FILE) {
+                        struct stat info;
+                        if (fstat(state.fd, &info) != 0) {
+                            op.error = errno;
+                            state.step = CLOSE;
+                            return;
+                        }
+                        op.contents.resize((size_t)info.st_size);
+                        total = op.contents.size();
+                    }
+                    state.step = total > 0 ? TRANSFER : op.sync ? SYNC : CLOSE;
+                    return;
+                }
+                case TRANSFER:
+                    if (res == 0 && op.kind == READ_FILE) {
+                        op.contents.resize(state.done); // shrank since the fstat
+                        total = state.done;
+                    }
+                    state.done += (size_t)res;
+                    if (state.done < total) return; // short transfer: queue the rest
+                    state.step = op.sync ? SYNC : op.kind == APPEND ? DONE : CLOSE;
+                    return;
+                case SYNC:
+                    state.step = op.kind == APPEND ? DONE : CLOSE;
+                    return;
+                case CLOSE:
+                    if (res < 0 && op.error == 0) op.error = -res;
+                    state.step = DONE;
+                    return;
+                case DONE:
+                    return;
+            }
+        }
+
+    public:
+        Ring() = default;
+        Ring(const Ring&) = delete;
+        Ring& operator=(const Ring&) = delete;
+
+        ~Ring() {
+            if (sqes != MAP_FAILED) munmap(sqes, sqeBytes);
+            if (rings != MAP_FAILED) munmap(rings, ringBytes);
+            if (fd >= 0) ::close(fd);
+        }
+
+        // Returns 0, or the errno that stopped the ring being set up
+        int setup() {
+            io_uring_params params{};
+            fd = (int)syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+            if (fd < 0) return errno;
+            // Kernels before 5.6 lack the single mapping and the read, write,
+            // open and close operations
+            uint32_t needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_RW_CUR_POS;
+            if ((params.features & needed) != needed) return ENOSYS;
+
+            ringBytes = max<size_t>(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                    params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+            rings = mmap(nullptr, ringBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (rings == MAP_FAILED) return errno;
+            sqeBytes = params.sq_entries * sizeof(io_uring_sqe);
+            sqes = (io_uring_sqe*)mmap(nullptr, sqeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                       IORING_OFF_SQES);
+            if (sqes == MAP_FAILED) return errno;
+
+            sqHead = at<unsigned>(params.sq_off.head);
+            sqTail = at<unsigned>(params.sq_off.tail);
+            sqMask = at<unsigned>(params.sq_off.ring_mask);
+            sqArray = at<unsigned>(params.sq_off.array);
+            cqHead = at<unsigned>(params.cq_off.head);
+            cqTail = at<unsigned>(params.cq_off.tail);
+            cqMask = at<unsigned>(params.cq_off.ring_mask);
+            cqes = at<io_uring_cqe>(params.cq_off.cqes);
+            tail = submitted = *sqTail;
+            return 0;
+        }
+
+        void run(vector<Op>& ops) {
+            vector<State> states(ops.size());
+            vector<uint32_t> ready(ops.size());
+            for (size_t i = 0; i < ops.size(); ++i) {
+                ready[i] = (uint32_t)(ops.size() - 1 - i); // popped from the back, so in order
+                if (ops[i].kind == APPEND) {
+                    states[i].fd = fileno(ops[i].stream);
+                    states[i].step = ops[i].data.empty() ? (ops[i].sync ? SYNC : DONE) : TRANSFER;
+                }
+            }
+            size_t remaining = ops.size(), inFlight = 0;
+            while (remaining > 0) {
+                while (!ready.empty() && inFlight < RING_ENTRIES) {
+                    uint32_t i = ready.back();
+                    ready.pop_back();
+                    if (states[i].step == DONE) {
+                        ops[i].ok = ops[i].error == 0;
+                        remaining--;
+                        continue;
+                    }
+                    queueStep(ops[i], states[i], i);
+                    inFlight++;
+                }
+                if (inFlight == 0) continue;
+                if (!enter(1)) {
+                    // Only a broken ring gets here (EINTR is retried); give up on the batch
+                    int error = errno;
+                    for (size_t i = 0; i < ops.size(); ++i) {
+                        if (states[i].step != DONE) ops[i].error = error;
+                    }
+                    return;
+                }
+                unsigned head = *cqHead;
+                unsigned end = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+                for (; head != end; ++head) {
+                    const io_uring_cqe& cqe = cqes[head & *cqMask];
+                    uint32_t i = (uint32_t)cqe.user_data;
+                    finishStep(ops[i], states[i], cqe.res);
+                    ready.push_back(i);
+                    inFlight--;
+                }
+                __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+            }
+        }
+    };
+
+    // The calling thread's ring, set up on first use; null when the pool is to be used
+    static Ring* threadRing() {
+        static mutex setupLock;
+        if (backend() == THREADS) return nullptr;
+        thread_local unique_ptr<Ring> ring;
+        thread_local bool tried = false;
+        if (!tried) {
+            tried = true;
+            lock_guard<mutex> guard(setupLock);
+            if (uringError() != 0) return nullptr;
+            auto created = make_unique<Ring>();
+            int error = created->setup();
+            if (error != 0) uringError() = error;
+            else ring = std::move(created);
+        }
+        return ring.get();
+    }
+#endif
+};
+
+// Append-only log of task changes, <user>_journal.txt, so a change is on disk
+// once the operation that made it returns, not only at the next save. Lines
+// are "P|<task line>" (the task's whole state, matched by id) or "D|<id>".
+// Replaying them in order over the last snapshot gives the current list, and
+// replaying a line twice is harmless. save() writes a snapshot and then
+// empties the journal.
+//
+// When records reach the disk depends on the process-wide policy:
+//   always  each commit is written and fdatasync'd before it returns
+//   group   commits are buffered; a shared background thread writes and syncs
+//           a journal once its oldest waiting record is `window` old or
+//           `maxRecords` are waiting, so a burst of changes costs one
+//           fdatasync. Journals falling due together go out as one AsyncIo
+//           batch. A crash can lose up to that window.
+//   none    written straight away but never synced, which survives the
+//           process dying but not the machine
+class Journal {
+public:
+    enum Mode { ALWAYS, GROUP, NONE };
+
+    struct Policy {
+        Mode mode = GROUP;
+        chrono::milliseconds window{10};
+        size_t maxRecords = 256;
+
+        // "always", "none" or "group[:ms[:records]]"
+        static bool parse(string_view text, Policy& out) {
+            string_view fields[3];
+            size_t count = StringUtils::split(text, ':', fields, 3);
+            Policy policy;
+            if (fields[0] == "always" && count == 1) policy.mode = ALWAYS;
+            else if (fields[0] == "none" && count == 1) policy.mode = NONE;
+            else if (fields[0] != "group") return false;
+            if (count >= 2) policy.window = chrono::milliseconds(max(0, StringUtils::toInt(fields[1], 10)));
+            if (count >= 3) policy.maxRecords = (size_t)max(1, StringUtils::toInt(fields[2], 256));
+            out = policy;
+            return true;
+        }
+
+        string describe() const {
+            if (mode == ALWAYS) return "always";
+            if (mode == NONE) return "none";
+            return "group, " + to_string(window.count()) + " ms / " + to_string(maxRecords) + " records";
+        }
+    };
+
+    // Set once at startup, before any journal is opened
+    static Policy& policy() {
+        static Policy current;
+        return current;
+    }
+
+    static constexpr const char* MAGIC = "#TaskReaperJournal";
+    static constexpr int VERSION = 1;
+
+private:
+    // The group-commit thread shared by every journal, started on first use.
+    // Journals due for a sync wait in `due` with their deadlines.
+    class Committer {
+    private:
+        mutex lock;
+        condition_variable changed;
+        vector<pair<chrono::steady_clock::time_point, Journal*>> due;
+        vector<Journal*> flushing;
+        bool stopping = false;
+        thread worker;
+
+        void run() {
+            unique_lock<mutex> guard(lock);
+            while (!stopping || !due.empty()) {
+                if (due.empty()) {
+                    changed.wait(guard);
+                    continue;
+                }
+                auto next = min_element(due.begin(), due.end());
+                // A copy: schedule() may grow `due` while this waits
+                auto deadline = next->first;
+                if (!stopping && deadline > chrono::steady_clock::now()) {
+                    changed.wait_until(guard, deadline);
+                    continue;
+                }
+                // Everything due by now goes out together
+                auto now = chrono::steady_clock::now();
+                for (auto it = due.begin(); it != due.end();) {
+                    if (!stopping && it->first > now) {
+                        ++it;
+                        continue;
+                    }
+                    flushing.push_back(it->second);
+                    it = due.erase(it);
+                }
+                guard.unlock();
+                if (flushing.size() == 1) flushing[0]->flush(true);
+                else flushTogether(flushing);
+                guard.lock();
+                flushing.clear();
+                changed.notify_all();
+            }
+        }
+
+    public:
+        static Committer& instance() {
+            static Committer committer;
+            return committer;
+        }
+
+        ~Committer() {
+            {
+                lock_guard<mutex> guard(lock);
+                stopping = true;
+            }
+            changed.notify_all();
+            if (worker.joinable()) worker.join();
+        }
+
+        // Sync journal by deadline (or sooner, if it is already due earlier)
+        void schedule(Journal* journal, chrono::steady_clock::time_point deadline) {
+            lock_guard<mutex> guard(lock);
+            if (!worker.joinable()) worker = thread([this] { run(); });
+            auto it = find_if(due.begin(), due.end(), [&](const auto& entry) { return entry.second == journal; });
+            if (it == due.end()) due.emplace_back(deadline, journal);
+            else it->first = min(it->first, deadline);
+            changed.notify_all();
+        }
+
+        // Forgets journal, waiting out a sync of it already under way
+        void cancel(Journal* journal) {
+            unique_lock<mutex> guard(lock);
+            due.erase(remove_if(due.begin(), due.end(), [&](const auto& entry) { return entry.second == journal; }),
+                      due.end());
+            changed.wait(guard, [&] { return find(flushing.begin(), flushing.end(), journal) == flushing.end(); });
+        }
+    };
+
+    string path;
+    FILE* file = nullptr;
+    string staged; // records of the operation in progress; owner's thread only
+    size_t stagedRecords = 0;
+    size_t committed = 0; // records in the file (or on their way), owner's thread only
+
+    mutex ioLock; // one writer at a time, so batches reach the file in commit order
+    mutex lock;   // guards the fields below, which the committer also reads
+    string pending; // committed, not yet written
+    size_t pendingRecords = 0;
+    chrono::steady_clock::time_point pendingSince; // when the oldest pending record was committed
+    bool failed = false;
+
+    void writeHeader() {
+        fprintf(file, "%s|%d\n", MAGIC, VERSION);
+        fflush(file);
+    }
+
+    struct Batch {
+        string bytes;
+        size_t records = 0;
+        chrono::steady_clock::time_point since; // when its oldest record was committed
+    };
+
+    // Takes everything pending; ioLock held
+    Batch takePending() {
+        Batch batch;
+        lock_guard<mutex> guard(lock);
+        batch.bytes.swap(pending);
+        batch.records = pendingRecords;
+        pendingRecords = 0;
+        batch.since = pendingSince;
+        return batch;
+    }
+
+    // Reports a failed write and records the batch's metrics; ioLock held
+    void written(const Batch& batch, int error) {
+        if (error != 0 && !failed) cerr << "Could not write journal " << path << ": " << strerror(error) << "\n";
+        failed = error != 0;
+        Perf::journalBatches().record(batch.records);
+        auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - batch.since);
+        Perf::histogram(Perf::JOURNAL_COMMIT).record((uint64_t)elapsed.count());
+    }
+
+    // Writes everything pending with one fwrite and, if sync, one fdatasync
+    void flush(bool sync) {
+        lock_guard<mutex> io(ioLock);
+        Batch batch = takePending();
+        if (batch.bytes.empty() || !file) return;
+
+        bool ok = fwrite(batch.bytes.data(), 1, batch.bytes.size(), file) == batch.bytes.size() && fflush(file) == 0;
+        if (ok && sync) {
+            Perf::Timer timer(Perf::JOURNAL_SYNC);
+            ok = AsyncIo::syncFile(file);
+        }
+        written(batch, ok ? 0 : errno);
+    }
+
+    // flush(true) for several journals, their writes and syncs issued as one batch
+    static void flushTogether(const vector<Journal*>& journals) {
+        vector<unique_lock<mutex>> io;
+        vector<Batch> batches;
+        vector<Journal*> writing;
+        for (Journal* journal : journals) {
+            io.emplace_back(journal->ioLock);
+            Batch batch = journal->takePending();
+            if (batch.bytes.empty() || !journal->file) continue;
+            batches.push_back(std::move(batch));
+            writing.push_back(journal);
+        }
+        vector<AsyncIo::Op> ops;
+        for (size_t i = 0; i < writing.size(); ++i) {
+            ops.push_back(AsyncIo::Op::append(writing[i]->file, batches[i].bytes, true));
+        }
+        {
+            Perf::Timer timer(Perf::JOURNAL_SYNC);
+            AsyncIo::run(ops);
+        }
+        for (size_t i = 0; i < writing.size(); ++i) writing[i]->written(batches[i], ops[i].ok ? 0 : ops[i].error);
+    }
+
+public:
+    Journal() = default;
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+    ~Journal() { close(); }
+
+    bool isOpen() const { return file != nullptr; }
+
+    // Opens the journal at filename, creating it if need be, and returns the
+    // records already in it in `existing` for replay. A torn last line, left
+    // by a crash mid-write, is cut off first.
+    bool open(const string& filename, string& existing) {
+        close();
+        path = filename;
+        existing.clear();
+        bool torn = false;
+        if (TaskFile::readAll(path, existing)) {
+            size_t end = existing.rfind('\n');
+            end = end == string::npos ? 0 : end + 1;
+            torn = end < existing.size();
+            existing.resize(end);
+        }
+        file = fopen(path.c_str(), existing.empty() || torn ? "wb" : "ab");
+        if (!file) return false;
+        if (existing.empty()) {
+            writeHeader();
+        } else if (torn) {
+            fwrite(existing.data(), 1, existing.size(), file);
+            fflush(file);
+        }
+        committed = existing.empty() ? 0 : count(existing.begin(), existing.end(), '\n') - 1;
+        return true;
+    }
+
+    // Records committed since the journal was last emptied or rotated
+    size_t records() const { return committed; }
+
+    // Adds one record (a full line, newline included) to the operation in progress
+    void stage(string_view record) {
+        staged.append(record);
+        stagedRecords++;
+    }
+
+    // Ends the operation in progress: its records go to disk as the policy says
+    void commit() {
+        if (staged.empty()) return;
+        if (!file) {
+            staged.clear();
+            stagedRecords = 0;
+            return;
+        }
+        auto now = chrono::steady_clock::now();
+        bool first;
+        size_t waiting;
+        {
+            lock_guard<mutex> guard(lock);
+            first = pending.empty();
+            if (first) pendingSince = now;
+            pending += staged;
+            pendingRecords += stagedRecords;
+            waiting = pendingRecords;
+        }
+        committed += stagedRecords;
+        staged.clear();
+        stagedRecords = 0;
+
+        const Policy& current = policy();
+        if (current.mode != GROUP) flush(current.mode == ALWAYS);
+        else if (waiting >= current.maxRecords) Committer::instance().schedule(this, now);
+        else if (first) Committer::instance().schedule(this, now + current.window);
+    }
+
+    // Empties the journal once a snapshot holding everything in it is on disk
+    void reset() {
+        lock_guard<mutex> io(ioLock);
+        {
+            lock_guard<mutex> guard(lock);
+            pending.clear();
+            pendingRecords = 0;
+        }
+        staged.clear();
+        stagedRecords = 0;
+        committed = 0;
+        if (!file) return;
+        fclose(file);
+        file = fopen(path.c_str(), "wb");
+        if (!file) return;
+        writeHeader();
+        if (policy().mode != NONE) AsyncIo::syncFile(file);
+    }
+
+    // Seals the records committed so far into sealedPath and carries on in
+    // an empty file, so a snapshot of the list as it is now can be written
+    // while later changes keep arriving. A sealed segment left by a snapshot
+    // that never finished is kept, with these records appended to it.
+    bool rotate(const string& sealedPath) {
+        if (!file) return false;
+        commit();
+        if (policy().mode == GROUP) Committer::instance().cancel(this);
+        flush(policy().mode != NONE);
+        lock_guard<mutex> io(ioLock);
+        fclose(file);
+        file = nullptr;
+
+        bool sealed;
+        string older;
+        if (TaskFile::readAll(sealedPath, older)) {
+            // Cut a torn tail so the first appended line starts a line of its own
+            size_t end = older.rfind('\n');
+            error_code ignored;
+            filesystem::resize_file(sealedPath, end == string::npos ? 0 : end + 1, ignored);
+            string current;
+            FILE* segment = fopen(sealedPath.c_str(), "ab");
+            sealed = segment && TaskFile::readAll(path, current) &&
+                     fwrite(current.data(), 1, current.size(), segment) == current.size() && fflush(segment) == 0;
+            if (sealed && policy().mode != NONE) sealed = AsyncIo::syncFile(segment);
+            if (segment) fclose(segment);
+        } else {
+            sealed = rename(path.c_str(), sealedPath.c_str()) == 0;
+        }
+        if (sealed && policy().mode != NONE) syncPath(".");
+
+        file = fopen(path.c_str(), sealed ? "wb" : "ab");
+        if (!file || !sealed) return false;
+        writeHeader();
+        committed = 0;
+        return true;
+    }
+
+    // Writes and syncs whatever is still waiting, then closes the file
+    void close() {
+        if (!file) return;
+        commit();
+        if (policy().mode == GROUP) Committer::instance().cancel(this);
+        flush(policy().mode != NONE);
+        lock_guard<mutex> io(ioLock);
+        fclose(file);
+        file = nullptr;
+    }
+
+    // Forces a file written through a stream (or a directory, after a rename
+    // in it) to disk. Used for snapshots, which are not written through here.
+    static void syncPath(const string& target) {
+#ifdef TASKREAPER_HAS_POSIX_IO
+        int fd = ::open(target.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        fsync(fd);
+        ::close(fd);
+#else
+        (void)target;
+#endif
+    }
+
+    // Length of the header line writeHeader() starts every journal with
+    static size_t headerBytes() { return char_traits<char>::length(MAGIC) + to_string(VERSION).size() + 2; }
+
+    // Appends text's complete lines to out, leaving off a torn last line
+    static void appendLines(string& out, string_view text) {
+        size_t end = text.rfind('\n');
+        if (end != string_view::npos) out.append(text.substr(0, end + 1));
+    }
+
+    // Calls put(record) for each P line and remove(id) for each D line of
+    // journal text, oldest first; other lines (the header) are skipped. The
+    // records' views point into text.
+    template <class Put, class Remove>
+    static void replay(string_view text, Put put, Remove remove) {
+        TaskRecord record;
+        while (!text.empty()) {
+            size_t eol = text.find('\n');
+            string_view line = text.substr(0, eol);
+            text.remove_prefix(eol == string_view::npos ? text.size() : eol + 1);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.size() < 3 || line[1] != '|') continue;
+            if (line[0] == 'P' && TaskFile::parseLine(line.substr(2), record)) put(record);
+            else if (line[0] == 'D') remove(StringUtils::toU64(line.substr(2)));
+        }
+    }
+};
+
+// A user's journal as seen by readers that go by the task file alone, without
+// opening a TaskStore (the all-users report and export): the last state of
+// each task the journal touches, merged into the file's records as they
+// stream past so the reader sees the list as the user left it
+class JournalOverlay {
+private:
+    struct Change {
+        TaskRecord record;
+        bool removed = false;
+        bool emitted = false;
+    };
+
+    string text; // sealed segment then journal; the records point into it
+    vector<Change> changes; // in the order their ids first appear
+    unordered_map<uint64_t, size_t> byId;
+
+public:
+    // sealed and live are the raw contents of the sealed segment and the
+    // journal; either may be empty
+    JournalOverlay(string_view sealed, string_view live) {
+        Journal::appendLines(text, sealed);
+        Journal::appendLines(text, live);
+        auto change = [&](uint64_t id) -> Change& {
+            auto [it, added] = byId.try_emplace(id, changes.size());
+            if (added) changes.emplace_back();
+            return changes[it->second];
+        };
+        Journal::replay(text, [&](const TaskRecord& record) { change(record.id) = {record}; },
+                        [&](uint64_t id) { change(id).removed = true; });
+    }
+    JournalOverlay(const JournalOverlay&) = delete;
+    JournalOverlay& operator=(const JournalOverlay&) = delete;
+
+    // Calls fn(record) for each task of a task file's body with the journal
+    // applied: changed tasks in their place, removed ones left out, then the
+    // tasks the journal added
+    template <class Fn>
+    void forEachRecord(string_view body, Fn fn) {
+        if (changes.empty()) return TaskFile::forEachRecord(body, fn);
+        for (auto& change : changes) change.emitted = false;
+        TaskFile::forEachRecord(body, [&](const TaskRecord& record) {
+            auto it = byId.find(record.id);
+            if (it == byId.end()) return fn(record);
+            Change& change = changes[it->second];
+            if (change.removed || change.emitted) return;
+            change.emitted = true;
+            fn(change.record);
+        });
+        for (auto& change : changes) {
+            if (!change.removed && !change.emitted) fn(change.record);
+        }
+    }
+};
+
+// Per-user task state: the arena-backed task list, the id counter and the
+// task file I/O. The interactive ToDoList owns one; the server keeps one per
+// resident user.
+class TaskStore {
+private:
+    // Session arena: tasks and their strings are carved out of a few large
+    // blocks that are handed back in one go when the session ends. The pool
+    // sits directly on the counting resource so buffers it passes through
+    // (the task vector as it grows) are freed when superseded.
+    CountingResource arenaBlocks;
+    pmr::unsynchronized_pool_resource sessionPool{&arenaBlocks};
+    CountingResource sessionPayload{&sessionPool}; // what tasks and strings take out of the pool
+
+public:
+    pmr::vector<Task> tasks{&sessionPayload};
+
+private:
+    string owner;
+    uint64_t nextTaskId = 1; // per-user high-water mark, persisted in the file header
+    bool dirty = false;
+    uint64_t generation = 0; // bumped by every mutation, keys the lazy indexes
+    mutable TaskIndex index;
+
+public:
+    struct Ranked {
+        int score;
+        uint32_t position;
+    };
+
+private:
+    mutable vector<Ranked> rankScratch; // topUrgent's heap, reused between calls
+    TrendCounters trendCounters;        // per-day history, kept in owner_trends.txt
+    Journal journal;                    // changes since the last save, kept in owner_journal.txt
+    ostringstream journalLine;          // formats journal records, reused between them
+    size_t deadCount = 0; // tombstoned slots in tasks
+    static constexpr size_t LOAD_CHUNK_BYTES = 1 << 20;  // below this a file is parsed inline
+    static constexpr size_t COMPACT_MIN_DEAD = 16;       // tombstones tolerated regardless of ratio
+    static constexpr size_t INDEX_MIN_TASKS = 1024;      // below this a query just scans
+    static constexpr size_t SNAPSHOT_RECORDS = 4096;     // journal records that start a background snapshot
+    static constexpr size_t SNAPSHOT_CHUNK = 4096;       // tasks serialized per step of a snapshot
+    static constexpr size_t SAVE_BATCH_BYTES = 64 << 20; // snapshot text saveAll() holds at once
+
+    // A snapshot being written by a background thread. It covers the list as
+    // it was when it started: the first `slots` positions, each chunk of them
+    // serialized once, either by the thread as it reaches the chunk or by a
+    // mutator about to change the chunk first (copy-on-write). Fields other
+    // than finished are guarded by snapshotLock while the thread runs.
+    struct SnapshotJob {
+        size_t slots = 0;
+        string head;           // header line and summary block, formatted at the start
+        vector<string> chunks; // text of chunks copied ahead of the thread
+        vector<uint8_t> taken; // chunks serialized so far, by either side
+        int32_t overdue = 0;
+        TrendCounters trends;  // as they were at the start, saved alongside
+        uint64_t generation = 0;
+        bool ok = false;
+        atomic<bool> finished{false};
+        thread worker;
+    };
+    unique_ptr<SnapshotJob> snapshot;
+    // Held by the snapshot thread while it reads tasks, and by mutators while
+    // they change them (or the vector's buffer), so the two never overlap
+    mutex snapshotLock;
+
+    void touch() {
+        dirty = true;
+        generation++;
+    }
+
+public:
+    TaskStore() = default;
+    TaskStore(const TaskStore&) = delete;
+    TaskStore& operator=(const TaskStore&) = delete;
+    ~TaskStore() { reapSnapshot(true); }
+
+    // owner's journal, and the segment a background snapshot seals off it
+    static string journalPath(const string& owner) { return owner + "_journal.txt"; }
+    static string sealedPath(const string& owner) { return owner + "_journal.sealed.txt"; }
+
+    // Whether owner has changes newer than the task file and its summary
+    // block: a sealed segment, or records past the journal's header
+    static bool hasJournalRecords(const string& owner) {
+        error_code ec;
+        if (filesystem::exists(sealedPath(owner), ec)) return true;
+        uintmax_t size = filesystem::file_size(journalPath(owner), ec);
+        return !ec && size > Journal::headerBytes();
+    }
+
+    const string& getOwner() const { return owner; }
+    bool isOpen() const { return !owner.empty(); }
+    bool isDirty() const { return dirty; }
+    // tasks[index] for a caller to change in place; it must call markDirty()
+    // afterwards. A snapshot under way gets its copy of the task first.
+    Task& modify(size_t index) {
+        auto guard = lockForChange();
+        preserve(index);
+        return tasks[index];
+    }
+
+    void markDirty(size_t index) {
+        touch();
+        logPut(tasks[index]);
+        commitChanges();
+    }
+
+    const TrendCounters& trends() const { return trendCounters; }
+
+    // Bytes behind this list: the arena's blocks, the indexes and the trend
+    // counters. The server charges this against its resident budget.
+    size_t memoryUsage() const {
+        return arenaBlocks.bytesInUse() + index.memoryBytes() + trendCounters.memoryBytes() +
+               rankScratch.capacity() * sizeof(Ranked);
+    }
+
+    // Where memoryUsage() goes. Arena, payload and index figures come from
+    // counting resources; the split of string bytes by field is a walk over
+    // the tasks.
+    struct MemoryReport {
+        size_t liveTasks = 0, slots = 0;
+        size_t taskObjects = 0;  // the task vector's buffer
+        size_t descriptions = 0, categories = 0, dueDates = 0;
+        size_t arenaReserved = 0; // blocks held from the system
+        size_t arenaOverhead = 0; // held but not handed out: pool rounding and free space
+        size_t indexes = 0;
+        size_t other = 0;         // trend counters and scratch buffers
+
+        size_t total() const { return arenaReserved + indexes + other; }
+    };
+
+    MemoryReport memoryReport() const {
+        MemoryReport report;
+        report.liveTasks = liveCount();
+        report.slots = tasks.size();
+        report.taskObjects = tasks.capacity() * sizeof(Task);
+        for (const auto& task : tasks) task.addStringBytes(report.descriptions, report.categories, report.dueDates);
+        report.arenaReserved = arenaBlocks.bytesInUse();
+        report.arenaOverhead = report.arenaReserved - min(report.arenaReserved, sessionPayload.bytesInUse());
+        report.indexes = index.memoryBytes();
+        report.other = trendCounters.memoryBytes() + rankScratch.capacity() * sizeof(Ranked);
+        return report;
+    }
+
+    // tasks may hold tombstoned slots; these count and test live tasks only
+    size_t liveCount() const { return tasks.size() - deadCount; }
+    bool empty() const { return liveCount() == 0; }
+    bool isLive(size_t index) const { return index < tasks.size() && !tasks[index].getIsDeleted(); }
+
+    // Loads username's task file; pool (may be null) parallelizes large files
+    void open(const string& username, ThreadPool* pool) {
+        close();
+        Perf::Timer timer(Perf::LOAD);
+        TRACE_SPAN("open session", username);
+        owner = username;
+        load(pool);
+        loadTrends();
+        replayJournal();
+    }
+
+    // Drops every task without saving and returns the arena to the system
+    // (changes since the last save stay in the journal for the next open)
+    void close() {
+        reapSnapshot(true);
+        journal.close();
+        owner.clear();
+        nextTaskId = 1;
+        dirty = false;
+        deadCount = 0;
+        generation++;
+        index.invalidate();
+        trendCounters.clear();
+        releaseSession();
+    }
+
+    Task& add(string_view desc, int prio, string_view due, string_view category, const RecurrenceRule& rule = {}) {
+        auto guard = lockForChange();
+        Task& task = tasks.emplace_back(nextTaskId++, desc, prio, due, category);
+        if (rule.active()) task.setRecurrence(rule);
+        trendCounters.record(TrendCounters::CREATED, DateUtils::todayNumber());
+        touch();
+        logPut(task);
+        commitChanges();
+        return task;
+    }
+
+    // Undoes add(): tombstones the task and takes back today's creation count
+    void undoAdd(size_t index) {
+        remove(index);
+        trendCounters.record(TrendCounters::CREATED, DateUtils::todayNumber(), -1);
+    }
+
+    // Completes tasks[index]. A recurring task moves on to its next
+    // occurrence instead and stays pending; returns true in that case.
+    // Either way the completion is dated and counted for today.
+    bool complete(size_t index) {
+        auto guard = lockForChange();
+        preserve(index);
+        bool advanced = completeAt(index);
+        commitChanges();
+        return advanced;
+    }
+
+    // Undoes complete(): takes back the completion on the day it was counted
+    // and puts back the task as it was before
+    void undoComplete(size_t index, const Task& previous) {
+        auto guard = lockForChange();
+        preserve(index);
+        trendCounters.record(TrendCounters::COMPLETED, tasks[index].getCompletedDay(), -1);
+        tasks[index] = previous;
+        touch();
+        logPut(tasks[index]);
+        commitChanges();
+    }
+
+    // Deletes tasks[index] by setting its tombstone: O(1), and every other
+    // task keeps its position (and display number) until the next compaction
+    void remove(size_t index) {
+        auto guard = lockForChange();
+        preserve(index);
+        removeAt(index);
+        commitChanges();
+    }
+
+    // Tombstones every matching task in one pass. Copies of the removed
+    // tasks and their positions are appended to `removed` (in ascending
+    // order) when given.
+    template <class Pred>
+    size_t removeWhere(Pred pred, vector<pair<int, Task>>* removed = nullptr) {
+        auto guard = lockForChange();
+        size_t count = 0;
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if (tasks[i].getIsDeleted() || !pred(tasks[i])) continue;
+            if (removed) removed->emplace_back((int)i, tasks[i]);
+            preserve(i);
+            removeAt(i);
+            count++;
+        }
+        commitChanges();
+        return count;
+    }
+
+    // Undoes remove/removeWhere. Tombstoned tasks are revived in place; any
+    // that a compaction has dropped since are merged back at their recorded
+    // positions in a single pass.
+    void restore(const vector<pair<int, Task>>& removed) {
+        auto guard = lockForChange();
+        vector<pair<int, Task>> compacted;
+        for (const auto& [index, task] : removed) {
+            if (index < (int)tasks.size() && tasks[index].getId() == task.getId() && tasks[index].getIsDeleted()) {
+                preserve(index);
+                tasks[index].markRestored();
+                deadCount--;
+            } else {
+                compacted.emplace_back(index, task);
+            }
+        }
+        if (!compacted.empty()) {
+            // Every position after the first merged task moves
+            preserve(compacted.front().first, tasks.size());
+            pmr::vector<Task> merged(tasks.get_allocator());
+            merged.reserve(tasks.size() + compacted.size());
+            size_t next = 0;
+            for (const auto& [index, task] : compacted) {
+                while ((int)merged.size() < index && next < tasks.size()) merged.push_back(std::move(tasks[next++]));
+                merged.push_back(task);
+            }
+            while (next < tasks.size()) merged.push_back(std::move(tasks[next++]));
+            tasks.swap(merged);
+        }
+        for (const auto& entry : removed) logPut(entry.second);
+        touch();
+        commitChanges();
+    }
+
+    // Drops the tombstones once they are a quarter of all slots, so a run of
+    // deletes costs one stable pass instead of a shift per delete. Positions
+    // (and display numbers) change only here; returns true if they did.
+    // Put off while a snapshot is being written.
+    bool compactIfNeeded() {
+        reapSnapshot(false);
+        if (snapshot || deadCount < COMPACT_MIN_DEAD || deadCount * 4 < tasks.size()) return false;
+        size_t kept = 0;
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if (tasks[i].getIsDeleted()) continue;
+            if (kept != i) tasks[kept] = std::move(tasks[i]);
+            kept++;
+        }
+        tasks.erase(tasks.begin() + kept, tasks.end());
+        deadCount = 0;
+        generation++;
+        return true;
+    }
+
+    // Position of a live task, trying `hint` (a position recorded earlier)
+    // before falling back to a search
+    int locate(uint64_t id, int hint) const {
+        if (hint >= 0 && isLive(hint) && tasks[hint].getId() == id) return hint;
+        return indexOf(id);
+    }
+
+    // Completes every matching pending task in one pass; the previous
+    // versions and their positions are appended to `before` when given
+    template <class Pred>
+    size_t completeWhere(Pred pred, vector<pair<int, Task>>* before = nullptr) {
+        auto guard = lockForChange();
+        size_t count = 0;
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if (tasks[i].getIsDeleted() || tasks[i].getIsCompleted() || !pred(tasks[i])) continue;
+            if (before) before->emplace_back((int)i, tasks[i]);
+            preserve(i);
+            completeAt(i);
+            count++;
+        }
+        commitChanges();
+        return count;
+    }
+
+    int indexOf(uint64_t id) const {
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if (tasks[i].getId() == id && !tasks[i].getIsDeleted()) return (int)i;
+        }
+        return -1;
+    }
+
+    // Indices of matching live tasks, in list order; goes parallel only for large lists
+    template <class Pred>
+    vector<int> scan(Pred pred, ThreadPool* pool) const {
+        auto live = [&](const Task& task) { return !task.getIsDeleted() && pred(task); };
+        if (!pool || tasks.size() < ParallelScan::SEQUENTIAL_THRESHOLD) {
+            return ParallelScan::sequential(tasks, live);
+        }
+        return ParallelScan::run(tasks, *pool, live);
+    }
+
+    // Calls fn(day, task) for every pending occurrence in [fromDay, toDay] in
+    // date order. Recurring tasks are expanded from their rules as the merge
+    // reaches them, so memory is one cursor per task, not one per occurrence.
+    template <class Fn>
+    void forEachOccurrence(int32_t fromDay, int32_t toDay, Fn fn) const {
+        struct Cursor {
+            int32_t day;
+            uint32_t task;
+            int64_t n; // occurrence index, -1 for a one-off task
+        };
+        auto later = [](const Cursor& a, const Cursor& b) {
+            return a.day != b.day ? a.day > b.day : a.task > b.task;
+        };
+        auto inRange = [&](const RecurrenceRule& rule, int32_t day) {
+            return day <= toDay && (!rule.hasEnd() || day <= rule.untilDay);
+        };
+
+        vector<Cursor> heap;
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            int32_t due;
+            if (tasks[i].getIsDeleted() || tasks[i].getIsCompleted()) continue;
+            if (!DateUtils::toDayNumber(tasks[i].getDueDate(), due)) continue;
+            const RecurrenceRule& rule = tasks[i].getRecurrence();
+            if (!rule.active()) {
+                if (due >= fromDay && due <= toDay) heap.push_back({due, (uint32_t)i, -1});
+                continue;
+            }
+            // Occurrences before the due date have already been completed
+            int64_t n = rule.firstOnOrAfter(max(fromDay, due));
+            int32_t day = rule.occurrence(n);
+            if (inRange(rule, day)) heap.push_back({day, (uint32_t)i, n});
+        }
+
+        make_heap(heap.begin(), heap.end(), later);
+        while (!heap.empty()) {
+            pop_heap(heap.begin(), heap.end(), later);
+            Cursor& cursor = heap.back();
+            const Task& task = tasks[cursor.task];
+            fn(cursor.day, task);
+            if (cursor.n >= 0) {
+                cursor.day = task.getRecurrence().occurrence(++cursor.n);
+                if (inRange(task.getRecurrence(), cursor.day)) {
+                    push_heap(heap.begin(), heap.end(), later);
+                    continue;
+                }
+            }
+            heap.pop_back();
+        }
+    }
+
+    // The k most urgent pending tasks, most urgent first (ties in list order).
+    // A bounded min-heap of k entries is kept while scanning, so this is
+    // O(n log k) with no full sort, and it reuses its buffer between calls.
+    // The result is valid until the next call.
+    const vector<Ranked>& topUrgent(size_t k) const {
+        rankScratch.clear();
+        if (k == 0) return rankScratch;
+        int32_t today;
+        DateUtils::toDayNumber(DateUtils::today(), today);
+
+        // "a ranks before b": higher score, then earlier position
+        auto before = [](const Ranked& a, const Ranked& b) {
+            return a.score != b.score ? a.score > b.score : a.position < b.position;
+        };
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if (tasks[i].getIsDeleted() || tasks[i].getIsCompleted()) continue;
+            Ranked entry{tasks[i].urgency(today), (uint32_t)i};
+            if (rankScratch.size() < k) {
+                rankScratch.push_back(entry);
+                push_heap(rankScratch.begin(), rankScratch.end(), before);
+            } else if (before(entry, rankScratch.front())) {
+                // front() is the weakest of the k kept so far
+                pop_heap(rankScratch.begin(), rankScratch.end(), before);
+                rankScratch.back() = entry;
+                push_heap(rankScratch.begin(), rankScratch.end(), before);
+            }
+        }
+        sort_heap(rankScratch.begin(), rankScratch.end(), before);
+        return rankScratch;
+    }
+
+    // Runs a query. The planner looks at the top-level AND terms, takes the
+    // most selective one an index can answer as the candidate set and checks
+    // the rest of the query on those candidates only. Small lists, or queries
+    // no index helps with, are scanned (in parallel for large lists). The
+    // chosen plan is described in *plan when given.
+    vector<int> query(const TaskQuery& q, ThreadPool* pool, string* plan = nullptr) const {
+        Perf::Timer timer(Perf::QUERY);
+        using Node = TaskQuery::Node;
+        string today = DateUtils::getCurrentDate();
+        const Node& root = q.root();
+
+        vector<const Node*> conjuncts;
+        if (root.kind == Node::AND) {
+            for (const auto& child : root.children) conjuncts.push_back(&child);
+        } else {
+            conjuncts.push_back(&root);
+        }
+
+        // Pick the index with the fewest candidates
+        const Node* best = nullptr;
+        size_t bestCount = liveCount();
+        if (liveCount() >= INDEX_MIN_TASKS) {
+            for (const Node* node : conjuncts) {
+                size_t count = estimate(*node);
+                if (count < bestCount) {
+                    best = node;
+                    bestCount = count;
+                }
+            }
+        }
+
+        vector<int> results;
+        if (!best || bestCount * 2 > liveCount()) {
+            if (plan) *plan = "full scan of " + to_string(liveCount()) + " tasks";
+            results = scan([&](const Task& task) { return q.matches(task, today); }, pool);
+        } else {
+            vector<uint32_t> candidates = lookup(*best);
+            if (plan) {
+                static const char* names[] = {"", "", "", "category", "priority", "due date", "", "text"};
+                *plan = string(names[best->kind]) + " index, " + to_string(candidates.size()) + " candidates";
+            }
+            // Category and due lookups are exact. Text candidates only share
+            // trigrams with the needle, and priority bucket 0 holds every
+            // out-of-range priority, so those terms are rechecked.
+            bool exact = best->kind == Node::CATEGORY || best->kind == Node::DUE;
+            for (uint32_t position : candidates) {
+                bool match = true;
+                for (const Node* node : conjuncts) {
+                    if (node == best && exact) continue;
+                    if (!TaskQuery::matches(*node, tasks[position], today)) {
+                        match = false;
+                        break;
+                    }
+                }
+                if (match) results.push_back((int)position);
+            }
+        }
+        q.sortResults(results, tasks);
+        return results;
+    }
+
+    TaskStats stats(ThreadPool* pool) const {
+        Perf::Timer timer(Perf::STATISTICS);
+        string today = DateUtils::getCurrentDate();
+        TaskStats result;
+        if (!pool || tasks.size() < ParallelScan::SEQUENTIAL_THRESHOLD) {
+            StatsPartial partial;
+            for (const auto& task : tasks) {
+                if (!task.getIsDeleted()) partial.add(task, today);
+            }
+            result.merge(partial);
+        } else {
+            auto partials = ParallelScan::reduce<StatsPartial>(tasks, *pool, [&](StatsPartial& partial, size_t i) {
+                if (!tasks[i].getIsDeleted()) partial.add(tasks[i], today);
+            });
+            for (const auto& partial : partials) result.merge(partial);
+        }
+        return result;
+    }
+
+    static void writeTask(ostream& out, const Task& task) {
+        char completedOn[10];
+        out << task.getId() << "|" << task.getDescription() << "|";
+        if (task.getIsCompleted() && task.getCompletedDay() != Task::NO_DAY) {
+            out << DateUtils::formatDay(task.getCompletedDay(), completedOn);
+        } else {
+            out << task.getIsCompleted();
+        }
+        out << "|" << task.getPriority() << "|"
+            << task.getDueDate() << "|" << task.getCategory() << "|"
+            << task.getIsRecurring() << "|" << task.getRecurringType();
+        const RecurrenceRule& rule = task.getRecurrence();
+        if (rule.active()) {
+            char until[10], start[10];
+            out << "|" << rule.interval << "|" << (rule.hasEnd() ? DateUtils::formatDay(rule.untilDay, until) : "")
+                << "|" << DateUtils::formatDay(rule.startDay, start);
+        }
+        out << "\n";
+    }
+
+    // Appends parsed records under fresh ids. Capacity grows geometrically,
+    // so a stream of batches doesn't reallocate the vector on every one.
+    void insertBatch(const vector<TaskRecord>& records) {
+        if (records.empty()) return;
+        auto guard = lockForChange();
+        size_t need = tasks.size() + records.size();
+        if (tasks.capacity() < need) tasks.reserve(max(need, tasks.capacity() * 2));
+        for (const auto& record : records) logPut(emplaceRecord(record, nextTaskId++));
+        trendCounters.record(TrendCounters::CREATED, DateUtils::todayNumber(), (int)records.size());
+        touch();
+        commitChanges();
+    }
+
+    // Writes a snapshot of the list and empties the journal. The snapshot goes
+    // to a temporary file that replaces the old one only once it is complete
+    // (and, unless the journal policy is none, synced), so a crash mid-save
+    // leaves the previous snapshot and the journal to replay over it. A
+    // background snapshot still running is waited for first.
+    void save() {
+        if (owner.empty()) return;
+        reapSnapshot(true);
+        Perf::Timer timer(Perf::SAVE);
+        TRACE_SPAN("save", owner);
+
+        string filename = owner + "_tasks.txt";
+        string staging = filename + ".tmp";
+        ofstream file(staging);
+        if (file.is_open()) {
+            writeHead(file);
+            string_view today = DateUtils::today();
+            int32_t overdue = 0;
+            for (const auto& task : tasks) {
+                if (task.getIsDeleted()) continue;
+                writeTask(file, task);
+                if (task.isOverdue(today)) overdue++;
+            }
+            file.close();
+            if (file.fail() || !install(staging, filename)) return;
+            saved(overdue);
+            ofstream trendFile(owner + "_trends.txt");
+            if (trendFile.is_open()) trendCounters.write(trendFile);
+        }
+    }
+
+    // save() for many lists at once, as the server does when it stops. The
+    // snapshots are formatted in memory, written and synced as one AsyncIo
+    // batch and renamed into place behind a single directory sync; the trend
+    // files follow as a second batch. Lists are taken in groups of about
+    // SAVE_BATCH_BYTES of text.
+    static void saveAll(const vector<TaskStore*>& stores) {
+        struct Pending {
+            TaskStore* store;
+            string text;
+            int32_t overdue = 0;
+        };
+        bool durable = Journal::policy().mode != Journal::NONE;
+        size_t next = 0;
+        while (next < stores.size()) {
+            vector<Pending> group;
+            size_t bytes = 0;
+            for (; next < stores.size() && bytes < SAVE_BATCH_BYTES; ++next) {
+                TaskStore& store = *stores[next];
+                if (store.owner.empty()) continue;
+                store.reapSnapshot(true);
+                ostringstream out;
+                store.writeHead(out);
+                string_view today = DateUtils::today();
+                int32_t overdue = 0;
+                for (const auto& task : store.tasks) {
+                    if (task.getIsDeleted()) continue;
+                    writeTask(out, task);
+                    if (task.isOverdue(today)) overdue++;
+                }
+                group.push_back({&store, std::move(out).str(), overdue});
+                bytes += group.back().text.size();
+            }
+            Perf::Timer timer(Perf::SAVE);
+            TRACE_SPAN("save all", to_string(group.size()));
+
+            vector<AsyncIo::Op> ops;
+            for (const auto& entry : group) {
+                ops.push_back(AsyncIo::Op::write(entry.store->owner + "_tasks.txt.tmp", entry.text, durable));
+            }
+            AsyncIo::run(ops);
+            vector<Pending*> installed;
+            for (size_t i = 0; i < group.size(); ++i) {
+                string filename = group[i].store->owner + "_tasks.txt";
+                if (ops[i].ok && rename(ops[i].path.c_str(), filename.c_str()) == 0) installed.push_back(&group[i]);
+            }
+            if (!installed.empty() && durable) Journal::syncPath(".");
+
+            ops.clear();
+            for (Pending* entry : installed) {
+                entry->store->saved(entry->overdue);
+                ostringstream out;
+                entry->store->trendCounters.write(out);
+                entry->text = std::move(out).str();
+                ops.push_back(AsyncIo::Op::write(entry->store->owner + "_trends.txt", entry->text, false));
+            }
+            AsyncIo::run(ops);
+        }
+    }
+
+private:
+    // Candidate count an index gives for a query term, or liveCount() when no
+    // index applies. Builds the indexes the term needs.
+    size_t estimate(const TaskQuery::Node& node) const {
+        using Node = TaskQuery::Node;
+        switch (node.kind) {
+            case Node::CATEGORY: {
+                index.ensureFields(tasks, generation);
+                auto it = index.byCategory.find(string_view(node.value));
+                return it == index.byCategory.end() ? 0 : it->second.size();
+            }
+            case Node::PRIORITY: {
+                index.ensureFields(tasks, generation);
+                size_t count = 0;
+                for (int p = 0; p < 4; ++p) {
+                    if (priorityInRange(node, p)) count += index.byPriority[p].size();
+                }
+                return count;
+            }
+            case Node::DUE: {
+                index.ensureFields(tasks, generation);
+                auto [first, last] = dueRange(node);
+                return (size_t)(last - first);
+            }
+            case Node::TEXT: {
+                if (node.value.size() < 3) return liveCount();
+                index.ensureText(tasks, generation);
+                size_t count = liveCount();
+                for (size_t at = 0; at + 3 <= node.value.size(); ++at) {
+                    auto it = index.byTrigram.find(TaskIndex::trigram(node.value.data() + at));
+                    count = min(count, it == index.byTrigram.end() ? 0 : it->second.size());
+                }
+                return count;
+            }
+            default:
+                return liveCount();
+        }
+    }
+
+    // Candidate positions for a term estimate() chose, in list order
+    vector<uint32_t> lookup(const TaskQuery::Node& node) const {
+        using Node = TaskQuery::Node;
+        vector<uint32_t> result;
+        switch (node.kind) {
+            case Node::CATEGORY: {
+                auto it = index.byCategory.find(string_view(node.value));
+                if (it != index.byCategory.end()) result.assign(it->second.begin(), it->second.end());
+                break;
+            }
+            case Node::PRIORITY:
+                for (int p = 0; p < 4; ++p) {
+                    if (priorityInRange(node, p)) {
+                        result.insert(result.end(), index.byPriority[p].begin(), index.byPriority[p].end());
+                    }
+                }
+                sort(result.begin(), result.end());
+                break;
+            case Node::DUE: {
+                auto [first, last] = dueRange(node);
+                result.assign(first, last);
+                sort(result.begin(), result.end());
+                break;
+            }
+            case Node::TEXT: {
+                // Intersect the posting lists, smallest first
+                vector<const TaskIndex::Positions*> lists;
+                for (size_t at = 0; at + 3 <= node.value.size(); ++at) {
+                    auto it = index.byTrigram.find(TaskIndex::trigram(node.value.data() + at));
+                    if (it == index.byTrigram.end()) return result;
+                    lists.push_back(&it->second);
+                }
+                sort(lists.begin(), lists.end(), [](auto* a, auto* b) { return a->size() < b->size(); });
+                result.assign(lists[0]->begin(), lists[0]->end());
+                vector<uint32_t> next;
+                for (size_t i = 1; i < lists.size() && !result.empty(); ++i) {
+                    next.clear();
+                    set_intersection(result.begin(), result.end(), lists[i]->begin(), lists[i]->end(), back_inserter(next));
+                    result.swap(next);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        return result;
+    }
+
+    static bool priorityInRange(const TaskQuery::Node& node, int bucket) {
+        if (bucket == 0) return node.low < 1 || node.high > 3; // out-of-range priorities
+        return bucket >= node.low && bucket <= node.high;
+    }
+
+    pair<TaskIndex::Positions::const_iterator, TaskIndex::Positions::const_iterator> dueRange(const TaskQuery::Node& node) const {
+        auto first = index.byDue.cbegin(), last = index.byDue.cend();
+        if (!node.from.empty()) {
+            first = lower_bound(first, last, node.from, [&](uint32_t position, const string& date) {
+                return tasks[position].getDueDate() < date;
+            });
+        }
+        if (!node.to.empty()) {
+            last = upper_bound(first, last, node.to, [&](const string& date, uint32_t position) {
+                return date < tasks[position].getDueDate();
+            });
+        }
+        return {first, last};
+    }
+
+
+    // Bookkeeping once a snapshot of the whole list is in place: the journal
+    // (and any sealed segment) is now redundant, and today's overdue count
+    // goes into the trends
+    void saved(int32_t overdue) {
+        error_code ignored;
+        filesystem::remove(sealedPath(owner), ignored);
+        journal.reset();
+        dirty = false;
+        trendCounters.sampleOverdue(DateUtils::todayNumber(), overdue);
+    }
+
+    // Header line (magic|format version|next id to hand out), then the summary
+    void writeHead(ostream& out) const {
+        out << TaskFile::MAGIC << "|" << TaskFile::VERSION << "|" << nextTaskId << "\n";
+        writeSummary(out);
+    }
+
+    // Moves a finished snapshot over the task file, synced unless the
+    // journal policy is none
+    static bool install(const string& staging, const string& filename) {
+        bool durable = Journal::policy().mode != Journal::NONE;
+        if (durable) Journal::syncPath(staging);
+        if (rename(staging.c_str(), filename.c_str()) != 0) return false;
+        if (durable) Journal::syncPath(".");
+        return true;
+    }
+
+    // Ends every operation: commits its journal records and, once the journal
+    // holds SNAPSHOT_RECORDS of them, folds it into the task file in the
+    // background
+    void commitChanges() {
+        journal.commit();
+        reapSnapshot(false);
+        if (!snapshot && journal.records() >= SNAPSHOT_RECORDS) startSnapshot();
+    }
+
+    // Starts a background snapshot of the list as it is now. The journal is
+    // rotated at the same point: what it held goes to the sealed segment,
+    // which the snapshot makes redundant, and changes from here on go to a
+    // fresh segment. The interactive thread only formats the header and
+    // summary; the thread serializes and writes the rest.
+    void startSnapshot() {
+        Perf::Timer timer(Perf::SNAPSHOT_START);
+        if (!journal.rotate(sealedPath(owner))) return;
+        auto job = make_unique<SnapshotJob>();
+        job->slots = tasks.size();
+        ostringstream head;
+        writeHead(head);
+        job->head = std::move(head).str();
+        size_t chunks = (job->slots + SNAPSHOT_CHUNK - 1) / SNAPSHOT_CHUNK;
+        job->chunks.resize(chunks);
+        job->taken.assign(chunks, 0);
+        job->trends = trendCounters;
+        job->generation = generation;
+        SnapshotJob* running = job.get();
+        snapshot = std::move(job);
+        running->worker = thread([this, running] { writeSnapshot(*running); });
+    }
+
+    // The snapshot thread
+    void writeSnapshot(SnapshotJob& job) {
+        Perf::Timer timer(Perf::SNAPSHOT);
+        TRACE_SPAN("snapshot", owner);
+        string filename = owner + "_tasks.txt";
+        string staging = filename + ".tmp";
+        ofstream file(staging);
+        if (file.is_open()) {
+            file << job.head;
+            string text;
+            for (size_t chunk = 0; chunk < job.taken.size(); ++chunk) {
+                {
+                    lock_guard<mutex> guard(snapshotLock);
+                    if (!job.taken[chunk]) serializeChunk(job, chunk);
+                    text = std::move(job.chunks[chunk]);
+                }
+                file << text;
+            }
+            file.close();
+            job.ok = !file.fail() && install(staging, filename);
+        }
+        if (job.ok) {
+            error_code ignored;
+            filesystem::remove(sealedPath(owner), ignored);
+            job.trends.sampleOverdue(DateUtils::todayNumber(), job.overdue);
+            ofstream trendFile(owner + "_trends.txt");
+            if (trendFile.is_open()) job.trends.write(trendFile);
+        }
+        job.finished = true;
+    }
+
+    // Formats one chunk of the snapshot's positions; snapshotLock is held
+    void serializeChunk(SnapshotJob& job, size_t chunk) {
+        string_view today = DateUtils::today();
+        ostringstream out;
+        size_t end = min(job.slots, (chunk + 1) * SNAPSHOT_CHUNK);
+        for (size_t i = chunk * SNAPSHOT_CHUNK; i < end; ++i) {
+            if (tasks[i].getIsDeleted()) continue;
+            writeTask(out, tasks[i]);
+            if (tasks[i].isOverdue(today)) job.overdue++;
+        }
+        job.chunks[chunk] = std::move(out).str();
+        job.taken[chunk] = 1;
+    }
+
+    // Taken by every mutator before it touches tasks. Empty (and free) when
+    // no snapshot is running.
+    unique_lock<mutex> lockForChange() {
+        if (!snapshot) return {};
+        return unique_lock<mutex>(snapshotLock);
+    }
+
+    // Copy-on-write: called with lockForChange() held before positions
+    // [first, last) change, it serializes the chunks covering them for the
+    // running snapshot unless that has already happened
+    void preserve(size_t first, size_t last) {
+        if (!snapshot || first >= snapshot->slots) return;
+        last = min(last, snapshot->slots);
+        for (size_t chunk = first / SNAPSHOT_CHUNK; chunk * SNAPSHOT_CHUNK < last; ++chunk) {
+            if (!snapshot->taken[chunk]) serializeChunk(*snapshot, chunk);
+        }
+    }
+
+    void preserve(size_t index) { preserve(index, index + 1); }
+
+    // Joins a snapshot thread that has finished (or, with wait, any) and
+    // frees what it held. The list is clean again if nothing changed since
+    // the snapshot started.
+    void reapSnapshot(bool wait) {
+        if (!snapshot || (!wait && !snapshot->finished)) return;
+        snapshot->worker.join();
+        if (snapshot->ok && snapshot->generation == generation) dirty = false;
+        snapshot.reset();
+    }
+
+    // Drop every task and return the arena's blocks to the system. The vector
+    // is swapped out first so its buffer is gone before the arena is released.
+    void releaseSession() {
+        pmr::vector<Task>(&sessionPayload).swap(tasks);
+        sessionPool.release();
+    }
+
+    bool completeAt(size_t index) {
+        int32_t today = DateUtils::todayNumber();
+        trendCounters.record(TrendCounters::COMPLETED, today);
+        touch();
+        bool advanced = tasks[index].advanceRecurrence();
+        if (advanced) tasks[index].setCompletedDay(today);
+        else tasks[index].markCompleted(today);
+        logPut(tasks[index]);
+        return advanced;
+    }
+
+    void removeAt(size_t index) {
+        tasks[index].markDeleted();
+        deadCount++;
+        touch();
+        journalLine.str("");
+        journalLine << "D|" << tasks[index].getId() << "\n";
+        journal.stage(journalLine.str());
+    }
+
+    // Stages a journal record holding the task's current state; the public
+    // mutators commit what they staged before returning
+    void logPut(const Task& task) {
+        journalLine.str("");
+        journalLine << "P|";
+        writeTask(journalLine, task);
+        journal.stage(journalLine.str());
+    }
+
+    // Opens owner_journal.txt and applies what it holds on top of the
+    // snapshot just loaded, after the sealed segment of a background snapshot
+    // that never finished, if there is one. The trend counts of replayed
+    // changes were never saved, so they are counted again here.
+    void replayJournal() {
+        int32_t createdDay = journalDay();
+        string live, sealed, data;
+        if (!journal.open(journalPath(owner), live)) return;
+        if (TaskFile::readAll(sealedPath(owner), sealed)) Journal::appendLines(data, sealed);
+        data += live;
+
+        unordered_map<uint64_t, uint32_t> positions; // live tasks by id, built at the first record
+        unordered_map<uint64_t, uint32_t> removed;   // tombstones the journal made, for a task put back
+        bool applied = false;
+        auto start = [&] {
+            if (applied) return;
+            positions.reserve(liveCount());
+            for (size_t i = 0; i < tasks.size(); ++i) {
+                if (!tasks[i].getIsDeleted()) positions[tasks[i].getId()] = (uint32_t)i;
+            }
+            applied = true;
+        };
+        Journal::replay(data, [&](const TaskRecord& record) {
+            start();
+            auto [it, added] = positions.try_emplace(record.id, (uint32_t)tasks.size());
+            auto gone = added ? removed.find(record.id) : removed.end();
+            const Task* previous = !added ? &tasks[it->second] : gone != removed.end() ? &tasks[gone->second] : nullptr;
+            countReplayed(previous, record, createdDay);
+            emplaceRecord(record, record.id);
+            if (!added) {
+                tasks[it->second] = std::move(tasks.back());
+                tasks.pop_back();
+            }
+            nextTaskId = max(nextTaskId, record.id + 1);
+        }, [&](uint64_t id) {
+            start();
+            auto it = positions.find(id);
+            if (it == positions.end()) return;
+            tasks[it->second].markDeleted();
+            deadCount++;
+            removed[id] = it->second;
+            positions.erase(it);
+        });
+        if (applied) touch();
+    }
+
+    // Trends for one replayed record. An id past the last one handed out is
+    // a new task; records carry no creation date, so it counts on the day
+    // the journal was last written. A done date that differs from the task's
+    // previous state completes it, or takes back the earlier completion. A
+    // recurring task that moved on records no done date and isn't counted.
+    void countReplayed(const Task* previous, const TaskRecord& record, int32_t createdDay) {
+        if (record.id >= nextTaskId) trendCounters.record(TrendCounters::CREATED, createdDay);
+        int32_t before = previous && previous->getIsCompleted() ? previous->getCompletedDay() : Task::NO_DAY;
+        int32_t after = record.isCompleted ? record.completedDay : Task::NO_DAY;
+        if (before == after) return;
+        trendCounters.record(TrendCounters::COMPLETED, before, -1);
+        trendCounters.record(TrendCounters::COMPLETED, after);
+    }
+
+    // Day the journal was last written, or today if there is none
+    int32_t journalDay() const {
+        error_code ec;
+        auto written = filesystem::last_write_time(journalPath(owner), ec);
+        if (ec) return DateUtils::todayNumber();
+        return DateUtils::dayOf(chrono::system_clock::to_time_t(chrono::file_clock::to_sys(written)));
+    }
+
+    Task& emplaceRecord(const TaskRecord& record, uint64_t id) {
+        Task& task = tasks.emplace_back(id, record.description, record.priority, record.dueDate, record.category);
+        if (record.isCompleted) task.markCompleted(record.completedDay);
+        if (record.recurrence.active()) task.setRecurrence(record.recurrence);
+        return task;
+    }
+
+    // The summary block (see TaskFile::Summary): one pass over the tasks,
+    // keeping the soonest-due pending ones in a small max-heap
+    void writeSummary(ostream& out) const {
+        auto earlier = [&](uint32_t a, uint32_t b) {
+            return make_pair(tasks[a].getDueDate(), a) < make_pair(tasks[b].getDueDate(), b);
+        };
+        vector<uint32_t> soonest;
+        size_t completed = 0;
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if (tasks[i].getIsDeleted()) continue;
+            if (tasks[i].getIsCompleted()) {
+                completed++;
+                continue;
+            }
+            if (soonest.size() == TaskFile::SUMMARY_TASKS) {
+                // front() is the latest kept so far; most tasks stop here
+                if (!earlier((uint32_t)i, soonest.front())) continue;
+                pop_heap(soonest.begin(), soonest.end(), earlier);
+                soonest.pop_back();
+            }
+            soonest.push_back((uint32_t)i);
+            push_heap(soonest.begin(), soonest.end(), earlier);
+        }
+        sort_heap(soonest.begin(), soonest.end(), earlier);
+
+        out << TaskFile::SUMMARY_TAG << "|" << liveCount() << "|" << completed << "|" << liveCount() - completed << "\n";
+        for (uint32_t i : soonest) {
+            const Task& task = tasks[i];
+            out << TaskFile::DUE_TAG << "|" << task.getId() << "|" << task.getDueDate() << "|" << task.getPriority()
+                << "|" << task.getDescription() << "\n";
+        }
+    }
+
+    // Reads owner_trends.txt. Without one, the completion history is rebuilt
+    // from the completion dates stored with the tasks.
+    void loadTrends() {
+        string data;
+        if (TaskFile::readAll(owner + "_trends.txt", data)) {
+            trendCounters.read(data);
+            return;
+        }
+        for (const auto& task : tasks) {
+            if (task.getIsCompleted()) trendCounters.record(TrendCounters::COMPLETED, task.getCompletedDay());
+        }
+    }
+
+    void load(ThreadPool* pool) {
+        string data;
+        if (!TaskFile::readAll(owner + "_tasks.txt", data)) return;
+
+        string_view text = data;
+        nextTaskId = max<uint64_t>(1, TaskFile::readHeader(text));
+
+        // Large files are cut at line boundaries and parsed concurrently into
+        // per-chunk buffers; appending the chunks in order keeps file order
+        size_t pieces = pool ? min<size_t>(text.size() / LOAD_CHUNK_BYTES + 1, pool->size() * 4) : 1;
+        vector<string_view> chunks = TaskFile::splitAtLines(text, pieces);
+        vector<vector<TaskRecord>> parsed(chunks.size());
+        if (chunks.size() > 1) {
+            pool->parallelFor(chunks.size(), [&](size_t i) { TaskFile::parseChunk(chunks[i], parsed[i]); });
+        } else if (!chunks.empty()) {
+            TaskFile::parseChunk(chunks[0], parsed[0]);
+        }
+
+        size_t total = 0;
+        for (const auto& chunk : parsed) total += chunk.size();
+        tasks.reserve(total);
+
+        // Files written before ids were persisted may carry junk in the id
+        // column; those tasks get fresh ids once the high-water mark is known
+        size_t unnumbered = 0;
+        for (const auto& chunk : parsed) {
+            for (const auto& record : chunk) {
+                if (record.id == 0) unnumbered++;
+                else nextTaskId = max(nextTaskId, record.id + 1);
+
+                emplaceRecord(record, record.id);
+            }
+        }
+
+        if (unnumbered > 0) {
+            for (auto& task : tasks) {
+                if (task.getId() == 0) task.setId(nextTaskId++);
+            }
+            touch();
+        }
+    }
+};
+
+// Streaming CSV / JSON-lines exchange. Memory stays flat however large the
+// file: export formats one row at a time into the stream's fixed buffer, and
+// import reads fixed-size chunks, unescapes fields in place and inserts each
+// chunk's rows into the store as one batch.
+class TaskExchange {
+public:
+    enum Format { CSV, JSON_LINES };
+    static constexpr size_t BUFFER_BYTES = 256 * 1024; // also the longest record accepted
+    static constexpr size_t MAX_REPORTED_ERRORS = 5;
+
+    struct ImportReport {
+        size_t imported = 0;
+        size_t rejected = 0;
+        vector<string> errors; // the first few rejections, "record N: reason"
+        string failure;        // set when the import stopped early
+    };
+
+    // .csv is CSV; anything else is read and written as JSON lines
+    static Format formatFor(string_view path) {
+        string_view ext = path.substr(min(path.size(), path.rfind('.')));
+        string lowered(ext);
+        transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
+        return lowered == ".csv" ? CSV : JSON_LINES;
+    }
+
+    static bool exportTasks(const TaskStore& store, const string& path, Format format, size_t& written) {
+        TRACE_SPAN("export", path);
+        vector<char> buffer(BUFFER_BYTES);
+        ofstream out;
+        out.rdbuf()->pubsetbuf(buffer.data(), (streamsize)buffer.size());
+        out.open(path, ios::binary | ios::trunc);
+        if (!out.is_open()) return false;
+
+        string row; // reused, so rows after the first don't allocate
+        written = 0;
+        if (format == CSV) out << "id,description,completed,priority,due,category,recurrence,interval,until,start\n";
+        for (const auto& task : store.tasks) {
+            if (task.getIsDeleted()) continue;
+            row.clear();
+            if (format == CSV) formatCsv(row, task);
+            else formatJson(row, task);
+            out.write(row.data(), (streamsize)row.size());
+            written++;
+        }
+        out.flush();
+        return bool(out);
+    }
+
+    static ImportReport importTasks(TaskStore& store, const string& path, Format format) {
+        TRACE_SPAN("import", path);
+        ImportReport report;
+        ifstream in(path, ios::binary);
+        if (!in.is_open()) {
+            report.failure = "cannot open " + path;
+            return report;
+        }
+
+        vector<char> buffer(BUFFER_BYTES);
+        vector<TaskRecord> batch;
+        Column csvColumns[MAX_COLUMNS];
+        size_t csvColumnCount = 0;
+        bool header = format == CSV, eof = false, first = true;
+        size_t filled = 0, recordNumber = 0;
+
+        while (!eof || filled > 0) {
+            if (!eof) {
+                in.read(buffer.data() + filled, (streamsize)(buffer.size() - filled));
+                filled += (size_t)in.gcount();
+                eof = !in;
+            }
+            size_t pos = 0;
+            if (first && filled >= 3 && memcmp(buffer.data(), "\xEF\xBB\xBF", 3) == 0) pos = 3; // UTF-8 BOM
+            first = false;
+
+            while (pos < filled) {
+                char* begin = buffer.data() + pos;
+                char* limit = buffer.data() + filled;
+                char* end = format == CSV ? findCsvRecordEnd(begin, limit) : (char*)memchr(begin, '\n', limit - begin);
+                if (!end) {
+                    if (!eof) break; // partial record: refill behind it
+                    end = limit;
+                }
+                pos = (size_t)(end - buffer.data()) + 1;
+                if (end > begin && end[-1] == '\r') end--;
+                if (end == begin) continue;
+                recordNumber++;
+
+                string error;
+                if (header) {
+                    header = false;
+                    if (!readCsvHeader(begin, end, csvColumns, csvColumnCount, report.failure)) return report;
+                    continue;
+                }
+                TaskRecord record;
+                bool ok = format == CSV ? parseCsvRecord(begin, end, csvColumns, csvColumnCount, record, error)
+                                        : parseJsonRecord(begin, end, record, error);
+                if (ok) {
+                    batch.push_back(record);
+                } else {
+                    report.rejected++;
+                    if (report.errors.size() < MAX_REPORTED_ERRORS) {
+                        report.errors.push_back("record " + to_string(recordNumber) + ": " + error);
+                    }
+                }
+            }
+
+            // The batch points into the buffer, so it goes in before the
+            // unread tail is moved to the front
+            store.insertBatch(batch);
+            report.imported += batch.size();
+            batch.clear();
+
+            pos = min(pos, filled);
+            if (pos == 0 && filled == buffer.size()) {
+                report.failure = "record " + to_string(recordNumber + 1) + " is longer than "
+                               + to_string(BUFFER_BYTES / 1024) + " KiB";
+                return report;
+            }
+            memmove(buffer.data(), buffer.data() + pos, filled - pos);
+            filled -= pos;
+        }
+        return report;
+    }
+
+private:
+    enum Column { ID, DESCRIPTION, COMPLETED, PRIORITY, DUE, CATEGORY, RECURRENCE, INTERVAL, UNTIL, START,
+                  IGNORED, COLUMN_COUNT = IGNORED };
+    static constexpr size_t MAX_COLUMNS = 32;
+
+    static Column columnFor(string_view name) {
+        static const char* names[] = {"id", "description", "completed", "priority", "due", "category",
+                                      "recurrence", "interval", "until", "start"};
+        for (int i = 0; i < COLUMN_COUNT; ++i) {
+            if (name == names[i]) return (Column)i;
+        }
+        return IGNORED;
+    }
+
+    static void appendCsvField(string& out, string_view field) {
+        if (field.find_first_of(",\"\r\n") == string_view::npos) {
+            out.append(field);
+            return;
+        }
+        out += '"';
+        for (char c : field) {
+            if (c == '"') out += '"';
+            out += c;
+        }
+        out += '"';
+    }
+
+    static void appendJsonString(string& out, string_view text) {
+        out += '"';
+        for (char c : text) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if ((unsigned char)c < 0x20) {
+                        static const char hex[] = "0123456789abcdef";
+                        out += "\\u00";
+                        out += hex[(unsigned char)c >> 4];
+                        out += hex[c & 15];
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+        out += '"';
+    }
+
+    static void formatCsv(string& row, const Task& task) {
+        const RecurrenceRule& rule = task.getRecurrence();
+        char until[10], start[10];
+        row.append(to_string(task.getId())).append(",");
+        appendCsvField(row, task.getDescription());
+        row.append(task.getIsCompleted() ? ",1," : ",0,").append(to_string(task.getPriority())).append(",");
+        row.append(task.getDueDate()).append(",");
+        appendCsvField(row, task.getCategory());
+        row.append(",").append(rule.name()).append(",");
+        if (rule.active()) {
+            row.append(to_string(rule.interval)).append(",");
+            if (rule.hasEnd()) row.append(DateUtils::formatDay(rule.untilDay, until));
+            row.append(",").append(DateUtils::formatDay(rule.startDay, start));
+        } else {
+            row.append(",,");
+        }
+        row += '\n';
+    }
+
+    static void formatJson(string& row, const Task& task) {
+        const RecurrenceRule& rule = task.getRecurrence();
+        row.append("{\"id\":").append(to_string(task.getId())).append(",\"description\":");
+        appendJsonString(row, task.getDescription());
+        row.append(",\"completed\":").append(task.getIsCompleted() ? "true" : "false");
+        row.append(",\"priority\":").append(to_string(task.getPriority())).append(",\"due\":");
+        appendJsonString(row, task.getDueDate());
+        row.append(",\"category\":");
+        appendJsonString(row, task.getCategory());
+        if (rule.active()) {
+            char day[10];
+            row.append(",\"recurrence\":\"").append(rule.name()).append("\",\"interval\":").append(to_string(rule.interval));
+            if (rule.hasEnd()) row.append(",\"until\":\"").append(DateUtils::formatDay(rule.untilDay, day)).append("\"");
+            row.append(",\"start\":\"").append(DateUtils::formatDay(rule.startDay, day)).append("\"");
+        }
+        row.append("}\n");
+    }
+
+    // End of the CSV record starting at begin: the first newline outside quotes
+    static char* findCsvRecordEnd(char* begin, char* limit) {
+        bool quoted = false;
+        for (char* p = begin; p < limit; ++p) {
+            if (*p == '"') quoted = !quoted;
+            else if (*p == '\n' && !quoted) return p;
+        }
+        return nullptr;
+    }
+
+    // Splits a CSV record into fields, unescaping quoted fields in place
+    static bool splitCsv(char* p, char* end, string_view* fields, size_t& count) {
+        count = 0;
+        while (true) {
+            char* start = p;
+            char* out = p;
+            if (p < end && *p == '"') {
+                ++p;
+                while (true) {
+                    if (p >= end) return false;
+                    if (*p == '"') {
+                        if (p + 1 < end && p[1] == '"') {
+                            *out++ = '"';
+                            p += 2;
+                            continue;
+                        }
+                        ++p;
+                        break;
+                    }
+                    *out++ = *p++;
+                }
+                if (p < end && *p != ',') return false;
+            } else {
+                while (p < end && *p != ',') ++p;
+                out = p;
+            }
+            if (count == MAX_COLUMNS) return false;
+            fields[count++] = string_view(start, (size_t)(out - start));
+            if (p >= end) return true;
+            ++p; // the comma
+        }
+    }
+
+    static bool readCsvHeader(char* begin, char* end, Column* columns, size_t& count, string& failure) {
+        string_view names[MAX_COLUMNS];
+        if (!splitCsv(begin, end, names, count)) {
+            failure = "malformed CSV header";
+            return false;
+        }
+        bool hasDescription = false, hasDue = false;
+        for (size_t i = 0; i < count; ++i) {
+            string name(names[i]);
+            transform(name.begin(), name.end(), name.begin(), ::tolower);
+            columns[i] = columnFor(name);
+            hasDescription |= columns[i] == DESCRIPTION;
+            hasDue |= columns[i] == DUE;
+        }
+        if (!hasDescription || !hasDue) failure = "CSV header needs description and due columns";
+        return failure.empty();
+    }
+
+    static bool parseCsvRecord(char* begin, char* end, const Column* columns, size_t columnCount,
+                               TaskRecord& record, string& error) {
+        string_view fields[MAX_COLUMNS];
+        size_t count;
+        if (!splitCsv(begin, end, fields, count)) {
+            error = "malformed CSV";
+            return false;
+        }
+        string_view values[COLUMN_COUNT];
+        for (size_t i = 0; i < count && i < columnCount; ++i) {
+            if (columns[i] != IGNORED) values[columns[i]] = fields[i];
+        }
+        return buildRecord(values, record, error);
+    }
+
+    static void appendUtf8(char*& out, uint32_t code) {
+        if (code < 0x80) {
+            *out++ = (char)code;
+        } else if (code < 0x800) {
+            *out++ = (char)(0xC0 | code >> 6);
+            *out++ = (char)(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            *out++ = (char)(0xE0 | code >> 12);
+            *out++ = (char)(0x80 | (code >> 6 & 0x3F));
+            *out++ = (char)(0x80 | (code & 0x3F));
+        } else {
+            *out++ = (char)(0xF0 | code >> 18);
+            *out++ = (char)(0x80 | (code >> 12 & 0x3F));
+            *out++ = (char)(0x80 | (code >> 6 & 0x3F));
+            *out++ = (char)(0x80 | (code & 0x3F));
+        }
+    }
+
+    static bool readHex4(const char* p, const char* end, uint32_t& value) {
+        if (end - p < 4) return false;
+        auto result = from_chars(p, p + 4, value, 16);
+        return result.ec == errc() && result.ptr == p + 4;
+    }
+
+    // Reads a JSON string at p (on the opening quote), unescaping it in place;
+    // escapes never take more bytes than the characters they stand for
+    static bool readJsonString(char*& p, char* end, string_view& value) {
+        char* out = ++p;
+        char* start = out;
+        while (p < end && *p != '"') {
+            if (*p != '\\') {
+                *out++ = *p++;
+                continue;
+            }
+            if (++p >= end) return false;
+            char c = *p++;
+            switch (c) {
+                case 'n': *out++ = '\n'; break;
+                case 'r': *out++ = '\r'; break;
+                case 't': *out++ = '\t'; break;
+                case 'b': *out++ = '\b'; break;
+                case 'f': *out++ = '\f'; break;
+                case 'u': {
+                    uint32_t code;
+                    if (!readHex4(p, end, code)) return false;
+                    p += 4;
+                    uint32_t low;
+                    if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u'
+                        && readHex4(p + 2, end, low) && low >= 0xDC00 && low < 0xE000) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        p += 6;
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default: *out++ = c; break; // \" \\ \/
+            }
+        }
+        if (p >= end) return false;
+        ++p; // closing quote
+        value = string_view(start, (size_t)(out - start));
+        return true;
+    }
+
+    static void skipSpace(char*& p, char* end) {
+        while (p < end && isspace((unsigned char)*p)) ++p;
+    }
+
+    // One flat JSON object per line; nested values are rejected
+    static bool parseJsonRecord(char* p, char* end, TaskRecord& record, string& error) {
+        string_view values[COLUMN_COUNT];
+        error = "malformed JSON object";
+        skipSpace(p, end);
+        if (p >= end || *p++ != '{') return false;
+        skipSpace(p, end);
+        if (p < end && *p == '}') {
+            ++p;
+        } else {
+            while (true) {
+                string_view key, value;
+                skipSpace(p, end);
+                if (p >= end || *p != '"' || !readJsonString(p, end, key)) return false;
+                skipSpace(p, end);
+                if (p >= end || *p++ != ':') return false;
+                skipSpace(p, end);
+                if (p < end && *p == '"') {
+                    if (!readJsonString(p, end, value)) return false;
+                } else {
+                    char* start = p;
+                    while (p < end && *p != ',' && *p != '}' && !isspace((unsigned char)*p)) ++p;
+                    value = string_view(start, (size_t)(p - start));
+                    if (value.empty() || value[0] == '{' || value[0] == '[') return false;
+                    if (value == "null") value = string_view();
+                }
+                Column column = columnFor(key);
+                if (column != IGNORED) values[column] = value;
+                skipSpace(p, end);
+                if (p < end && *p == ',') {
+                    ++p;
+                    continue;
+                }
+                if (p < end && *p == '}') {
+                    ++p;
+                    break;
+                }
+                return false;
+            }
+        }
+        skipSpace(p, end);
+        if (p != end) return false;
+        error.clear();
+        return buildRecord(values, record, error);
+    }
+
+    // The task file is '|' and line delimited, so those become spaces
+    static string_view sanitize(string_view field) {
+        char* p = const_cast<char*>(field.data()); // views point into the import buffer
+        for (size_t i = 0; i < field.size(); ++i) {
+            if (p[i] == '|' || p[i] == '\n' || p[i] == '\r') p[i] = ' ';
+        }
+        return field;
+    }
+
+    static bool buildRecord(string_view* values, TaskRecord& record, string& error) {
+        record = TaskRecord();
+        record.id = 0;
+        record.description = sanitize(values[DESCRIPTION]);
+        if (record.description.empty()) {
+            error = "missing description";
+            return false;
+        }
+
+        string_view completed = values[COMPLETED];
+        if (completed == "1" || completed == "true" || completed == "yes") record.isCompleted = true;
+        else if (completed.empty() || completed == "0" || completed == "false" || completed == "no") record.isCompleted = false;
+        else {
+            error = "completed must be true/false or 1/0";
+            return false;
+        }
+
+        record.priority = values[PRIORITY].empty() ? 2 : StringUtils::toInt(values[PRIORITY], -1);
+        if (record.priority < 1 || record.priority > 3) {
+            error = "priority must be 1-3";
+            return false;
+        }
+
+        int32_t dueDay;
+        record.dueDate = values[DUE];
+        if (!DateUtils::toDayNumber(record.dueDate, dueDay)) {
+            error = "due date must be a valid YYYY-MM-DD date";
+            return false;
+        }
+        record.category = values[CATEGORY].empty() ? string_view("General") : sanitize(values[CATEGORY]);
+
+        RecurrenceRule& rule = record.recurrence;
+        if (!values[RECURRENCE].empty() && values[RECURRENCE] != "none") {
+            rule.frequency = RecurrenceRule::parseFrequency(values[RECURRENCE]);
+            int interval = values[INTERVAL].empty() ? 1 : StringUtils::toInt(values[INTERVAL], 0);
+            if (!rule.active() || interval < 1 || interval > 365) {
+                error = "recurrence must be daily, weekly or monthly with an interval of 1-365";
+                return false;
+            }
+            rule.interval = (uint16_t)interval;
+            rule.startDay = dueDay;
+            if ((!values[UNTIL].empty() && !DateUtils::toDayNumber(values[UNTIL], rule.untilDay))
+                || (!values[START].empty() && !DateUtils::toDayNumber(values[START], rule.startDay))) {
+                error = "until/start must be valid YYYY-MM-DD dates";
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Just enough of a FlatBuffers encoder for the Arrow IPC metadata. Objects
+// are written front to back: a table goes out with placeholder offsets, then
+// the objects it refers to, and the placeholders are patched, so every
+// offset points forward as the format requires. Positions are relative to
+// the start of the buffer, which the caller places at an 8-byte boundary.
+class FlatWriter {
+public:
+    using Child = function<size_t(FlatWriter&)>; // writes an object, returns its position
+
+    struct Field {
+        int slot;
+        int size;           // 1, 2, 4 or 8 for a scalar; 0 for an offset to child
+        uint64_t value = 0;
+        Child child;
+    };
+
+    static Field scalar(int slot, int size, uint64_t value) { return Field{slot, size, value, nullptr}; }
+    static Field offset(int slot, Child child) { return Field{slot, 0, 0, std::move(child)}; }
+
+    // Buffer holding root, padded to a multiple of 8 bytes
+    static vector<uint8_t> finish(const Child& root) {
+        FlatWriter writer;
+        writer.put<uint32_t>(0);
+        writer.patch(0, root(writer));
+        writer.pad(8);
+        return std::move(writer.bytes);
+    }
+
+    size_t table(const vector<Field>& fields) {
+        int slots = 0;
+        for (const auto& field : fields) slots = max(slots, field.slot + 1);
+
+        pad(2);
+        size_t vtable = bytes.size();
+        bytes.resize(vtable + 4 + 2 * slots, 0);
+
+        pad(8);
+        size_t start = bytes.size();
+        put<int32_t>((int32_t)(start - vtable));
+        vector<size_t> positions(fields.size());
+        for (size_t i = 0; i < fields.size(); ++i) {
+            int size = fields[i].size ? fields[i].size : 4;
+            pad(size);
+            positions[i] = bytes.size();
+            for (int b = 0; b < size; ++b) bytes.push_back(fields[i].size ? uint8_t(fields[i].value >> (8 * b)) : 0);
+        }
+
+        auto put16 = [&](size_t at, size_t value) {
+            bytes[at] = uint8_t(value);
+            bytes[at + 1] = uint8_t(value >> 8);
+        };
+        put16(vtable, 4 + 2 * slots);
+        put16(vtable + 2, bytes.size() - start);
+        for (size_t i = 0; i < fields.size(); ++i) put16(vtable + 4 + 2 * fields[i].slot, positions[i] - start);
+
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (fields[i].size == 0) patch(positions[i], fields[i].child(*this));
+        }
+        return start;
+    }
+
+    size_t string(string_view text) {
+        pad(4);
+        size_t start = bytes.size();
+        put<uint32_t>((uint32_t)text.size());
+        bytes.insert(bytes.end(), text.begin(), text.end());
+        bytes.push_back(0);
+        return start;
+    }
+
+    // Vector of structs whose largest member is 8 bytes wide
+    size_t structs(const void* data, size_t count, size_t elementSize) {
+        pad(8, 4);
+        size_t start = bytes.size();
+        put<uint32_t>((uint32_t)count);
+        const uint8_t* raw = (const uint8_t*)data;
+        bytes.insert(bytes.end(), raw, raw + count * elementSize);
+        return start;
+    }
+
+    size_t tables(const vector<Child>& elements) {
+        pad(4);
+        size_t start = bytes.size();
+        put<uint32_t>((uint32_t)elements.size());
+        size_t first = bytes.size();
+        bytes.resize(first + 4 * elements.size(), 0);
+        for (size_t i = 0; i < elements.size(); ++i) patch(first + 4 * i, elements[i](*this));
+        return start;
+    }
+
+private:
+    vector<uint8_t> bytes;
+
+    void pad(size_t alignment, size_t extra = 0) {
+        while ((bytes.size() + extra) % alignment) bytes.push_back(0);
+    }
+
+    template <class T>
+    void put(T value) {
+        for (size_t b = 0; b < sizeof(T); ++b) bytes.push_back(uint8_t((uint64_t)value >> (8 * b)));
+    }
+
+    // uoffsets are relative to where they are stored
+    void patch(size_t at, size_t target) {
+        uint32_t value = (uint32_t)(target - at);
+        for (int b = 0; b < 4; ++b) bytes[at + b] = uint8_t(value >> (8 * b));
+    }
+};
+
+// Columnar export in the Arrow IPC file format (what pyarrow, pandas, polars
+// and DuckDB read as Feather v2). Tasks are appended straight into the
+// column buffers, with no row objects in between, and written as one
+// dictionary batch per dictionary-encoded column plus a single record batch:
+//   id uint64, description utf8, completed bool, priority int8,
+//   due date32 (null if unparseable), category dictionary<int32, utf8>,
+//   recurrence dictionary<int32, utf8> (null if none), and for multi-user
+//   exports user dictionary<int32, utf8>
+class ArrowExport {
+private:
+    // Arrow flatbuffer enum values
+    enum TypeId : uint8_t { INT = 2, UTF8 = 5, BOOL = 6, DATE = 8 };
+    enum MessageKind : uint8_t { SCHEMA = 1, DICTIONARY_BATCH = 2, RECORD_BATCH = 3 };
+    static constexpr int METADATA_V5 = 4;
+    enum { CATEGORY_DICTIONARY, RECURRENCE_DICTIONARY, USER_DICTIONARY };
+
+    struct StringColumn {
+        vector<int32_t> offsets{0};
+        string data;
+        void add(string_view value) {
+            data.append(value);
+            offsets.push_back((int32_t)data.size());
+        }
+    };
+
+    // Dictionary values in Arrow's offsets + data layout, plus a lookup
+    struct Dictionary {
+        StringColumn values;
+        map<string, int32_t, less<>> lookup;
+        int32_t indexOf(string_view value) {
+            auto it = lookup.find(value);
+            if (it != lookup.end()) return it->second;
+            int32_t index = (int32_t)lookup.size();
+            lookup.emplace(string(value), index);
+            values.add(value);
+            return index;
+        }
+    };
+
+    struct Bitmap {
+        vector<uint8_t> bits;
+        size_t unset = 0;
+        void add(size_t row, bool value) {
+            if (row % 8 == 0) bits.push_back(0);
+            if (value) bits.back() |= uint8_t(1 << (row % 8));
+            else unset++;
+        }
+    };
+
+    struct Buffer {
+        const void* data;
+        size_t length;
+    };
+
+    struct Block {
+        int64_t offset;
+        int32_t metaDataLength;
+        int32_t padding;
+        int64_t bodyLength;
+    };
+
+    bool withUser;
+    size_t rowCount = 0;
+    vector<uint64_t> ids;
+    StringColumn descriptions;
+    Bitmap completed;
+    vector<int8_t> priorities;
+    vector<int32_t> dueDays;
+    Bitmap dueValid;
+    vector<int32_t> categories;
+    vector<int32_t> recurrences;
+    Bitmap recurrenceValid;
+    vector<int32_t> users;
+    Dictionary categoryDictionary, recurrenceDictionary, userDictionary;
+
+    static size_t padded(size_t length) { return (length + 7) & ~size_t(7); }
 
-        ostringstream oss;
-        oss << (1900 + ltm->tm_year) << "-"
-            << setfill('0') << setw(2) << (1 + ltm->tm_mon) << "-"
-            << setfill('0') << setw(2) << ltm->tm_mday;
+    void add(uint64_t id, string_view description, bool isCompleted, int priority, string_view due,
+             string_view category, const RecurrenceRule& rule, int32_t user) {
+        ids.push_back(id);
+        descriptions.add(description);
+        completed.add(rowCount, isCompleted);
+        priorities.push_back((int8_t)priority);
+        int32_t day = 0;
+        dueValid.add(rowCount, DateUtils::toDayNumber(due, day));
+        dueDays.push_back(day);
+        categories.push_back(categoryDictionary.indexOf(category));
+        recurrenceValid.add(rowCount, rule.active());
+        recurrences.push_back(rule.active() ? (int32_t)rule.frequency - 1 : 0);
+        if (withUser) users.push_back(user);
+        rowCount++;
+    }
+
+    static FlatWriter::Child intType(int bits, bool isSigned) {
+        return [=](FlatWriter& w) {
+            return w.table({FlatWriter::scalar(0, 4, bits), FlatWriter::scalar(1, 1, isSigned)});
+        };
+    }
+
+    static FlatWriter::Child field(string name, bool nullable, TypeId type, FlatWriter::Child typeTable,
+                                   int dictionaryId = -1) {
+        return [=](FlatWriter& w) {
+            vector<FlatWriter::Field> fields = {
+                FlatWriter::offset(0, [&](FlatWriter& w) { return w.string(name); }),
+                FlatWriter::scalar(1, 1, nullable),
+                FlatWriter::scalar(2, 1, type),
+                FlatWriter::offset(3, typeTable),
+                FlatWriter::offset(5, [](FlatWriter& w) { return w.tables({}); }),
+            };
+            if (dictionaryId >= 0) {
+                fields.push_back(FlatWriter::offset(4, [=](FlatWriter& w) {
+                    return w.table({FlatWriter::scalar(0, 8, (uint64_t)dictionaryId),
+                                    FlatWriter::offset(1, intType(32, true)),
+                                    FlatWriter::scalar(2, 1, 0)});
+                }));
+            }
+            return w.table(fields);
+        };
+    }
+
+    FlatWriter::Child schema() const {
+        auto empty = [](FlatWriter& w) { return w.table({}); };
+        auto date = [](FlatWriter& w) { return w.table({FlatWriter::scalar(0, 2, 0)}); }; // DateUnit DAY
+        vector<FlatWriter::Child> fields = {
+            field("id", false, INT, intType(64, false)),
+            field("description", false, UTF8, empty),
+            field("completed", false, BOOL, empty),
+            field("priority", false, INT, intType(8, true)),
+            field("due", true, DATE, date),
+            field("category", false, UTF8, empty, CATEGORY_DICTIONARY),
+            field("recurrence", true, UTF8, empty, RECURRENCE_DICTIONARY),
+        };
+        if (withUser) fields.push_back(field("user", false, UTF8, empty, USER_DICTIONARY));
+        return [fields](FlatWriter& w) {
+            return w.table({FlatWriter::scalar(0, 2, 0), // little endian
+                            FlatWriter::offset(1, [&](FlatWriter& w) { return w.tables(fields); })});
+        };
+    }
+
+    // RecordBatch table for `rows` rows with the given field nodes and body
+    // buffers; fills bodyLength
+    static FlatWriter::Child recordBatch(size_t rows, const vector<int64_t>& nodes, const vector<Buffer>& buffers,
+                                         size_t& bodyLength) {
+        vector<int64_t> layout; // Buffer structs: offset, length
+        bodyLength = 0;
+        for (const auto& buffer : buffers) {
+            layout.push_back((int64_t)bodyLength);
+            layout.push_back((int64_t)buffer.length);
+            bodyLength += padded(buffer.length);
+        }
+        return [=](FlatWriter& w) {
+            return w.table({FlatWriter::scalar(0, 8, rows),
+                            FlatWriter::offset(1, [&](FlatWriter& w) { return w.structs(nodes.data(), nodes.size() / 2, 16); }),
+                            FlatWriter::offset(2, [&](FlatWriter& w) { return w.structs(layout.data(), layout.size() / 2, 16); })});
+        };
+    }
+
+    static vector<uint8_t> message(MessageKind kind, const FlatWriter::Child& header, size_t bodyLength) {
+        return FlatWriter::finish([&](FlatWriter& w) {
+            return w.table({FlatWriter::scalar(0, 2, METADATA_V5), FlatWriter::scalar(1, 1, kind),
+                            FlatWriter::offset(2, header), FlatWriter::scalar(3, 8, bodyLength)});
+        });
+    }
+
+    // Encapsulated message: continuation marker, metadata length, metadata,
+    // then the body buffers, each padded to 8 bytes
+    static Block writeMessage(ostream& out, size_t& position, const vector<uint8_t>& metadata,
+                              const vector<Buffer>& body, size_t bodyLength) {
+        static const uint8_t zeros[8] = {};
+        Block block{(int64_t)position, (int32_t)(8 + metadata.size()), 0, (int64_t)bodyLength};
+        uint32_t prefix[2] = {0xFFFFFFFFu, (uint32_t)metadata.size()};
+        out.write((const char*)prefix, sizeof(prefix));
+        out.write((const char*)metadata.data(), (streamsize)metadata.size());
+        for (const auto& buffer : body) {
+            out.write((const char*)buffer.data, (streamsize)buffer.length);
+            out.write((const char*)zeros, (streamsize)(padded(buffer.length) - buffer.length));
+        }
+        position += 8 + metadata.size() + bodyLength;
+        return block;
+    }
+
+public:
+    explicit ArrowExport(bool includeUser = false) : withUser(includeUser) {
+        for (string_view name : {"daily", "weekly", "monthly"}) recurrenceDictionary.indexOf(name);
+    }
+
+    size_t rows() const { return rowCount; }
+
+    int32_t addUser(string_view name) { return userDictionary.indexOf(name); }
+
+    void add(const Task& task, int32_t user = 0) {
+        if (task.getIsDeleted()) return;
+        add(task.getId(), task.getDescription(), task.getIsCompleted(), task.getPriority(), task.getDueDate(),
+            task.getCategory(), task.getRecurrence(), user);
+    }
+
+    void add(const TaskRecord& record, int32_t user = 0) {
+        add(record.id, record.description, record.isCompleted, record.priority, record.dueDate,
+            record.category, record.recurrence, user);
+    }
+
+    bool write(const string& path) const {
+        TRACE_SPAN("arrow write", path);
+        vector<char> streamBuffer(TaskExchange::BUFFER_BYTES);
+        ofstream out;
+        out.rdbuf()->pubsetbuf(streamBuffer.data(), (streamsize)streamBuffer.size());
+        out.open(path, ios::binary | ios::trunc);
+        if (!out.is_open()) return false;
+
+        out.write("ARROW1\0\0", 8);
+        size_t position = 8;
+        FlatWriter::Child schemaTable = schema();
+        writeMessage(out, position, message(SCHEMA, schemaTable, 0), {}, 0);
+
+        vector<Block> dictionaryBlocks, batchBlocks;
+        const Dictionary* dictionaries[] = {&categoryDictionary, &recurrenceDictionary, &userDictionary};
+        for (int id = 0; id < (withUser ? 3 : 2); ++id) {
+            const StringColumn& values = dictionaries[id]->values;
+            size_t count = values.offsets.size() - 1, bodyLength;
+            vector<Buffer> body = {{nullptr, 0},
+                                   {values.offsets.data(), values.offsets.size() * sizeof(int32_t)},
+                                   {values.data.data(), values.data.size()}};
+            FlatWriter::Child batch = recordBatch(count, {(int64_t)count, 0}, body, bodyLength);
+            vector<uint8_t> metadata = message(DICTIONARY_BATCH, [&](FlatWriter& w) {
+                return w.table({FlatWriter::scalar(0, 8, (uint64_t)id), FlatWriter::offset(1, batch),
+                                FlatWriter::scalar(2, 1, 0)});
+            }, bodyLength);
+            dictionaryBlocks.push_back(writeMessage(out, position, metadata, body, bodyLength));
+        }
+
+        // One node (length, null count) and validity + value buffers per
+        // column, in schema order; all-valid columns omit their bitmap
+        int64_t rows = (int64_t)rowCount;
+        vector<int64_t> nodes = {rows, 0, rows, 0, rows, 0, rows, 0, rows, (int64_t)dueValid.unset,
+                                 rows, 0, rows, (int64_t)recurrenceValid.unset};
+        vector<Buffer> body = {
+            {nullptr, 0}, {ids.data(), ids.size() * sizeof(uint64_t)},
+            {nullptr, 0}, {descriptions.offsets.data(), descriptions.offsets.size() * sizeof(int32_t)},
+            {descriptions.data.data(), descriptions.data.size()},
+            {nullptr, 0}, {completed.bits.data(), completed.bits.size()},
+            {nullptr, 0}, {priorities.data(), priorities.size()},
+            {dueValid.bits.data(), dueValid.unset ? dueValid.bits.size() : 0}, {dueDays.data(), dueDays.size() * sizeof(int32_t)},
+            {nullptr, 0}, {categories.data(), categories.size() * sizeof(int32_t)},
+            {recurrenceValid.bits.data(), recurrenceValid.unset ? recurrenceValid.bits.size() : 0},
+            {recurrences.data(), recurrences.size() * sizeof(int32_t)},
+        };
+        if (withUser) {
+            nodes.insert(nodes.end(), {rows, 0});
+            body.insert(body.end(), {{nullptr, 0}, {users.data(), users.size() * sizeof(int32_t)}});
+        }
+        size_t bodyLength;
+        FlatWriter::Child batch = recordBatch(rowCount, nodes, body, bodyLength);
+        batchBlocks.push_back(writeMessage(out, position, message(RECORD_BATCH, batch, bodyLength), body, bodyLength));
 
-        return dueDate <= oss.str() && dueDate >= getCurrentDate();
+        // End-of-stream marker, then the footer that indexes the blocks
+        uint32_t endOfStream[2] = {0xFFFFFFFFu, 0};
+        out.write((const char*)endOfStream, sizeof(endOfStream));
+        vector<uint8_t> footer = FlatWriter::finish([&](FlatWriter& w) {
+            return w.table({FlatWriter::scalar(0, 2, METADATA_V5), FlatWriter::offset(1, schemaTable),
+                            FlatWriter::offset(2, [&](FlatWriter& w) { return w.structs(dictionaryBlocks.data(), dictionaryBlocks.size(), sizeof(Block)); }),
+                            FlatWriter::offset(3, [&](FlatWriter& w) { return w.structs(batchBlocks.data(), batchBlocks.size(), sizeof(Block)); })});
+        });
+        int32_t footerLength = (int32_t)footer.size();
+        out.write((const char*)footer.data(), (streamsize)footer.size());
+        out.write((const char*)&footerLength, sizeof(footerLength));
+        out.write("ARROW1", 6);
+        out.flush();
+        return bool(out);
     }
 };
 
-// Enhanced Task class
-class Task {
+// Byte-oriented LZ77 compressor in the LZ4 block layout: a run of sequences,
+// each a token (high nibble literal count, low nibble match length - 4, 15
+// meaning more length bytes follow), the literals, and a 2-byte offset back
+// into the output. The last sequence has literals only. Compression is a
+// greedy single-probe hash of 4-byte prefixes; decompression is a copy loop
+// with no entropy stage, which is what keeps it fast.
+class Lz {
 private:
-    static int nextId;
-    int id;
-    string description;
-    bool isCompleted;
-    int priority;
-    string dueDate;
-    string category;
-    bool isRecurring;
-    string recurringType; // "daily", "weekly", "monthly"
+    static constexpr int HASH_BITS = 16;
+    static constexpr size_t MIN_MATCH = 4;
+    static constexpr size_t MAX_OFFSET = 65535;
+    static constexpr size_t TAIL_LITERALS = 8; // the end of the input is always literals
+
+    static uint32_t read32(const char* at) {
+        uint32_t value;
+        memcpy(&value, at, 4);
+        return value;
+    }
+
+    static uint32_t hash(uint32_t prefix) { return (prefix * 2654435761u) >> (32 - HASH_BITS); }
+
+    static void putLength(string& out, size_t length) {
+        for (; length >= 255; length -= 255) out.push_back((char)255);
+        out.push_back((char)length);
+    }
+
+    static bool readLength(const uint8_t*& in, const uint8_t* end, size_t& length) {
+        uint8_t byte;
+        do {
+            if (in == end) return false;
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    static void putSequence(string& out, string_view literals, size_t offset, size_t matchLength) {
+        size_t extra = matchLength - MIN_MATCH;
+        out.push_back((char)((min<size_t>(literals.size(), 15) << 4) | min<size_t>(extra, 15)));
+        if (literals.size() >= 15) putLength(out, literals.size() - 15);
+        out.append(literals);
+        out.push_back((char)(offset & 0xFF));
+        out.push_back((char)(offset >> 8));
+        if (extra >= 15) putLength(out, extra - 15);
+    }
 
 public:
-    Task(const string& desc, int prio, const string& due, const string& cat = "General")
-        : id(nextId++), description(desc), isCompleted(false), priority(prio),
-          dueDate(due), category(cat), isRecurring(false), recurringType("") {}
+    // Bytes past the end of the output that decompress() may scribble on
+    static constexpr size_t SLACK = 16;
+    // Most output one input byte can decode to (a 255 match-length byte)
+    static constexpr size_t MAX_EXPANSION = 255;
 
-    // Getters
-    int getId() const { return id; }
-    string getDescription() const { return description; }
-    bool getIsCompleted() const { return isCompleted; }
-    int getPriority() const { return priority; }
-    string getDueDate() const { return dueDate; }
-    string getCategory() const { return category; }
-    bool getIsRecurring() const { return isRecurring; }
-    string getRecurringType() const { return recurringType; }
+    static void compress(string_view in, string& out) {
+        vector<uint32_t> table(size_t(1) << HASH_BITS, 0); // position + 1 of the last prefix with each hash
+        size_t anchor = 0, at = 0;
+        size_t limit = in.size() > TAIL_LITERALS + MIN_MATCH ? in.size() - TAIL_LITERALS - MIN_MATCH : 0;
+        while (at < limit) {
+            uint32_t prefix = read32(in.data() + at);
+            uint32_t& slot = table[hash(prefix)];
+            size_t candidate = slot;
+            slot = (uint32_t)at + 1;
+            if (candidate == 0 || at - (candidate - 1) > MAX_OFFSET || read32(in.data() + candidate - 1) != prefix) {
+                at += 1 + ((at - anchor) >> 6); // step faster through incompressible runs
+                continue;
+            }
+            size_t from = candidate - 1, length = MIN_MATCH;
+            while (at + length < in.size() - TAIL_LITERALS && in[from + length] == in[at + length]) length++;
+            // Grow the match backwards over literals that also match
+            while (at > anchor && from > 0 && in[at - 1] == in[from - 1]) {
+                at--;
+                from--;
+                length++;
+            }
+            putSequence(out, in.substr(anchor, at - anchor), at - from, length);
+            at += length;
+            anchor = at;
+            if (at - 2 < limit) table[hash(read32(in.data() + at - 2))] = (uint32_t)(at - 2) + 1;
+        }
+        string_view rest = in.substr(anchor);
+        out.push_back((char)(min<size_t>(rest.size(), 15) << 4));
+        if (rest.size() >= 15) putLength(out, rest.size() - 15);
+        out.append(rest);
+    }
 
-    // Setters
-    void setDescription(const string& desc) { description = desc; }
-    void setPriority(int prio) { priority = prio; }
-    void setDueDate(const string& due) { dueDate = due; }
-    void setCategory(const string& cat) { category = cat; }
-    void markCompleted() { isCompleted = true; }
-    void markPending() { isCompleted = false; }
-    void setRecurring(const string& type) {
-        isRecurring = true;
-        recurringType = type;
+    // Decodes into out, which must have room for outLength + SLACK bytes.
+    // False if the input is malformed or doesn't decode to exactly outLength.
+    static bool decompress(const char* data, size_t length, char* out, size_t outLength) {
+        const uint8_t* in = (const uint8_t*)data;
+        const uint8_t* end = in + length;
+        char* op = out;
+        char* outEnd = out + outLength;
+        while (in < end) {
+            uint8_t token = *in++;
+            size_t literals = token >> 4;
+            if (literals < 15 && end - in >= 16) {
+                // Short run with input to spare: one fixed 16-byte copy
+                if (literals > (size_t)(outEnd - op)) return false;
+                memcpy(op, in, 16);
+            } else {
+                if (literals == 15 && !readLength(in, end, literals)) return false;
+                if (literals > (size_t)(end - in) || literals > (size_t)(outEnd - op)) return false;
+                memcpy(op, in, literals);
+            }
+            op += literals;
+            in += literals;
+            if (in == end) break;
+
+            if (end - in < 2) return false;
+            size_t offset = in[0] | (size_t)in[1] << 8;
+            in += 2;
+            size_t match = (token & 15);
+            if (match == 15 && !readLength(in, end, match)) return false;
+            match += MIN_MATCH;
+            if (offset == 0 || offset > (size_t)(op - out) || match > (size_t)(outEnd - op)) return false;
+
+            const char* from = op - offset;
+            if (offset >= 16 && match <= 16) {
+                memcpy(op, from, 16);
+            } else if (offset >= 8) {
+                // Eight bytes at a time; may run up to 7 bytes past the match
+                for (size_t done = 0; done < match; done += 8) memcpy(op + done, from + done, 8);
+            } else {
+                for (size_t i = 0; i < match; ++i) op[i] = from[i];
+            }
+            op += match;
+        }
+        return op == outEnd;
     }
+};
 
-    string getPriorityString() const {
-        switch (priority) {
-            case 1: return "High";
-            case 2: return "Medium";
-            case 3: return "Low";
-            default: return to_string(priority);
+// Archive of completed tasks, <user>_archive.bin, so they stop costing load
+// time and memory in the task file. The file is a run of self-contained
+// blocks of up to BLOCK_TASKS tasks each, sorted by id. Blocks are only ever
+// appended; a torn block at the end is cut off before the next append, but
+// an archive damaged anywhere else is not appended to.
+//
+//   header   "TRA1", then u32 LE: payload bytes, tasks, text bytes (what the
+//            decoded strings take), suffix bytes, packed suffix bytes, bit
+//            stream bytes, and the bytes the tasks took in the task file
+//   varints  the category dictionary (count, then length + bytes each), the
+//            first id, the anchor day, a base and bit width per column, then
+//            the rare fields in task order: out-of-range priorities, due
+//            dates that aren't dates, recurrence rules
+//   bits     a row per task of the columns below, each stored as its value
+//            minus the column's base in the column's width (frame of
+//            reference, so a column that never varies takes no bits):
+//              flags      priority (0 = out of range) and the bits in Flags
+//              id         delta from the previous id
+//              due        zigzag delta from the previous due day (the
+//                         decoded text of a due day is shared while it
+//                         stays in a small table of recent days)
+//              completed  zigzag delta from the task's due day, or from the
+//                         previous completion day when there is none
+//              category   dictionary index
+//              shared     length shared with the previous description
+//              rest       length of the rest of the description
+//   packed suffixes  the rest of each description, concatenated and
+//                    compressed with Lz
+class TaskArchive {
+public:
+    static constexpr size_t BLOCK_TASKS = 65536;
+    static constexpr size_t HEADER_BYTES = 32;
+
+    struct Block {
+        string text; // descriptions, categories and due dates; the records point into it
+        vector<TaskRecord> records;
+        size_t sourceBytes = 0;
+        string suffixes; // decompression buffer, kept for the next block
+    };
+
+    struct Report {
+        size_t archived = 0;
+        size_t sourceBytes = 0;  // what the archived tasks took in the task file
+        size_t archiveBytes = 0; // what they take in the archive
+        string failure;
+    };
+
+    struct Stats {
+        size_t blocks = 0, tasks = 0, sourceBytes = 0, fileBytes = 0;
+    };
+
+private:
+    enum Flags : uint8_t {
+        PRIORITY = 3, COMPLETED = 1 << 2, DUE_DAY = 1 << 3, DUE_TEXT = 1 << 4, COMPLETED_DAY = 1 << 5,
+        RECURRING = 1 << 6,
+    };
+    enum Column { FLAGS, ID, DUE, COMPLETED_ON, CATEGORY, SHARED, REST, COLUMNS };
+    static constexpr char MAGIC[4] = {'T', 'R', 'A', '1'};
+    static constexpr size_t BIT_SLACK = 8; // zero bytes after the bit stream, so reads can load 8 bytes at a time
+    static constexpr size_t DUE_SLOTS = 256; // recently seen due days whose text is shared, by day % DUE_SLOTS
+
+    static void putVarint(string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back((char)(value | 0x80));
+            value >>= 7;
         }
+        out.push_back((char)value);
     }
 
-    bool isOverdue() const {
-        return !isCompleted && DateUtils::isOverdue(dueDate);
+    static uint64_t zigzag(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+    static int64_t unzigzag(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+    static void putU32(char* at, size_t value) {
+        for (int i = 0; i < 4; ++i) at[i] = (char)(value >> (8 * i));
+    }
+    static uint32_t getU32(const char* at) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) value |= (uint32_t)(uint8_t)at[i] << (8 * i);
+        return value;
     }
 
-    bool isDueSoon() const {
-        return !isCompleted && DateUtils::isDueSoon(dueDate);
+    // Bounds-checked varint reader; once it runs off the end every read fails
+    struct Reader {
+        const uint8_t* at;
+        const uint8_t* end;
+        bool ok = true;
+
+        uint64_t varint() {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (at == end) break;
+                uint8_t byte = *at++;
+                value |= (uint64_t)(byte & 0x7F) << shift;
+                if (byte < 0x80) return value;
+            }
+            ok = false;
+            return 0;
+        }
+
+        string_view bytes(size_t length) {
+            if (length > (size_t)(end - at)) {
+                ok = false;
+                return {};
+            }
+            string_view value((const char*)at, length);
+            at += length;
+            return value;
+        }
+    };
+
+    // Little-endian bit packing, least significant bit first
+    struct BitWriter {
+        string& out;
+        uint64_t pending = 0;
+        int count = 0;
+
+        void put(uint64_t value, int width) {
+            if (width > 32) {
+                put(value & 0xFFFFFFFF, 32);
+                put(value >> 32, width - 32);
+                return;
+            }
+            pending |= (value & ((uint64_t(1) << width) - 1)) << count;
+            count += width;
+            for (; count >= 8; count -= 8, pending >>= 8) out.push_back((char)pending);
+        }
+
+        void finish() {
+            if (count > 0) out.push_back((char)pending);
+            out.append(BIT_SLACK, '\0');
+        }
+    };
+
+    // Reads what BitWriter wrote; the caller checks the stream is long enough
+    struct BitReader {
+        const char* data;
+        size_t position = 0;
+
+        uint64_t get(int width) {
+            if (width > 32) {
+                uint64_t low = get(32);
+                return low | get(width - 32) << 32;
+            }
+            uint64_t word;
+            memcpy(&word, data + (position >> 3), 8);
+            uint64_t value = (word >> (position & 7)) & ((uint64_t(1) << width) - 1);
+            position += width;
+            return value;
+        }
+    };
+
+    // Appends one block holding tasks, which must be sorted by id
+    static void encode(const vector<const Task*>& tasks, size_t sourceBytes, string& out) {
+        string varints, bits, suffixes;
+        unordered_map<string_view, uint32_t> categories;
+        vector<string_view> dictionary;
+        size_t textBytes = 0;
+        for (const Task* task : tasks) {
+            if (categories.emplace(task->getCategory(), (uint32_t)dictionary.size()).second) {
+                dictionary.push_back(task->getCategory());
+                textBytes += task->getCategory().size();
+            }
+        }
+        putVarint(varints, dictionary.size());
+        for (string_view category : dictionary) {
+            putVarint(varints, category.size());
+            varints.append(category);
+        }
+
+        // The anchor seeds the date deltas: the first due day, else the first completion day
+        int32_t anchor = 0;
+        for (const Task* task : tasks) {
+            if (DateUtils::toDayNumber(task->getDueDate(), anchor)) break;
+            if (task->getCompletedDay() != Task::NO_DAY) {
+                anchor = task->getCompletedDay();
+                break;
+            }
+        }
+
+        vector<uint64_t> rows(tasks.size() * COLUMNS);
+        string rare;
+        uint64_t previousId = tasks.empty() ? 0 : tasks[0]->getId();
+        int32_t previousDue = anchor, previousCompleted = anchor;
+        int32_t formatted[DUE_SLOTS]; // due days already in the text, by day % DUE_SLOTS
+        fill(begin(formatted), end(formatted), Task::NO_DAY);
+        string_view previousDescription;
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            const Task* task = tasks[i];
+            uint64_t* row = &rows[i * COLUMNS];
+            int priority = task->getPriority();
+            int32_t due = 0;
+            string_view dueText = task->getDueDate();
+            uint8_t flags = priority >= 1 && priority <= 3 ? (uint8_t)priority : 0;
+            if (task->getIsCompleted()) flags |= COMPLETED;
+            if (DateUtils::toDayNumber(dueText, due)) flags |= DUE_DAY;
+            else if (!dueText.empty()) flags |= DUE_TEXT;
+            if (task->getCompletedDay() != Task::NO_DAY) flags |= COMPLETED_DAY;
+            if (task->getIsRecurring()) flags |= RECURRING;
+            row[FLAGS] = flags;
+
+            if ((flags & PRIORITY) == 0) putVarint(rare, zigzag(priority));
+            row[ID] = task->getId() - previousId;
+            previousId = task->getId();
+            if (flags & DUE_DAY) {
+                row[DUE] = zigzag((int64_t)due - previousDue);
+                int32_t& slot = formatted[(uint32_t)due % DUE_SLOTS];
+                if (slot != due) textBytes += 10;
+                slot = due;
+                previousDue = due;
+            } else if (flags & DUE_TEXT) {
+                putVarint(rare, dueText.size());
+                rare.append(dueText);
+                textBytes += dueText.size();
+            }
+            if (flags & COMPLETED_DAY) {
+                int32_t from = flags & DUE_DAY ? due : previousCompleted;
+                row[COMPLETED_ON] = zigzag((int64_t)task->getCompletedDay() - from);
+                previousCompleted = task->getCompletedDay();
+            }
+            row[CATEGORY] = categories[task->getCategory()];
+
+            string_view description = task->getDescription();
+            size_t shared = 0, limit = min(description.size(), previousDescription.size());
+            while (shared < limit && description[shared] == previousDescription[shared]) shared++;
+            row[SHARED] = shared;
+            row[REST] = description.size() - shared;
+            suffixes.append(description.substr(shared));
+            textBytes += description.size();
+            previousDescription = description;
+
+            if (flags & RECURRING) {
+                const RecurrenceRule& rule = task->getRecurrence();
+                putVarint(rare, rule.frequency);
+                putVarint(rare, rule.interval);
+                putVarint(rare, zigzag(rule.untilDay));
+                putVarint(rare, zigzag(rule.startDay));
+            }
+        }
+
+        putVarint(varints, tasks.empty() ? 0 : tasks[0]->getId());
+        putVarint(varints, zigzag(anchor));
+        uint64_t base[COLUMNS];
+        int width[COLUMNS];
+        for (int c = 0; c < COLUMNS; ++c) {
+            uint64_t low = UINT64_MAX, high = 0;
+            for (size_t i = 0; i < tasks.size(); ++i) {
+                low = min(low, rows[i * COLUMNS + c]);
+                high = max(high, rows[i * COLUMNS + c]);
+            }
+            base[c] = tasks.empty() ? 0 : low;
+            width[c] = tasks.empty() ? 0 : (int)bit_width(high - low);
+            putVarint(varints, base[c]);
+            putVarint(varints, (uint64_t)width[c]);
+        }
+        varints.append(rare);
+
+        BitWriter writer{bits};
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            for (int c = 0; c < COLUMNS; ++c) writer.put(rows[i * COLUMNS + c] - base[c], width[c]);
+        }
+        writer.finish();
+
+        string packed;
+        Lz::compress(suffixes, packed);
+        size_t start = out.size();
+        out.resize(start + HEADER_BYTES);
+        memcpy(&out[start], MAGIC, 4);
+        putU32(&out[start + 4], varints.size() + bits.size() + packed.size());
+        putU32(&out[start + 8], tasks.size());
+        putU32(&out[start + 12], textBytes);
+        putU32(&out[start + 16], suffixes.size());
+        putU32(&out[start + 20], packed.size());
+        putU32(&out[start + 24], bits.size());
+        putU32(&out[start + 28], sourceBytes);
+        out.append(varints);
+        out.append(bits);
+        out.append(packed);
+    }
+
+    // Length of the run of whole blocks at the start of path. torn is left
+    // false if what follows them is more than one last block cut short by a
+    // crash mid-append (a bad magic, or another block after a short one):
+    // then the file is damaged, not torn.
+    static size_t validLength(const string& path, bool* torn = nullptr) {
+        if (torn) *torn = true;
+        ifstream in(path, ios::binary);
+        if (!in.is_open()) return 0;
+        in.seekg(0, ios::end);
+        size_t fileBytes = (size_t)in.tellg(), at = 0;
+        char header[HEADER_BYTES];
+        while (at < fileBytes) {
+            size_t have = min(fileBytes - at, HEADER_BYTES);
+            in.seekg((streamoff)at);
+            if (!in.read(header, (streamsize)have) || memcmp(header, MAGIC, min(have, sizeof(MAGIC))) != 0) {
+                if (torn) *torn = false;
+                break;
+            }
+            if (have < HEADER_BYTES) break;
+            size_t next = at + HEADER_BYTES + getU32(header + 4);
+            if (next > fileBytes) {
+                // A length that overruns the file is only a torn tail if no
+                // later block starts after it
+                if (torn) {
+                    string rest((size_t)(fileBytes - at - HEADER_BYTES), '\0');
+                    in.read(rest.data(), (streamsize)rest.size());
+                    *torn = rest.find(string_view(MAGIC, sizeof(MAGIC))) == string::npos;
+                }
+                break;
+            }
+            at = next;
+        }
+        return at;
     }
 
-    // Create next occurrence for recurring tasks
-    Task createNextOccurrence() const {
-        if (!isRecurring) return *this;
+public:
+    // Decodes the block at the start of data into out. Returns the bytes it
+    // took, or 0 if data doesn't start with a whole, well-formed block.
+    static size_t decode(string_view data, Block& out) {
+        if (data.size() < HEADER_BYTES || memcmp(data.data(), MAGIC, 4) != 0) return 0;
+        size_t payload = getU32(data.data() + 4), count = getU32(data.data() + 8);
+        size_t textBytes = getU32(data.data() + 12), suffixBytes = getU32(data.data() + 16);
+        size_t packedBytes = getU32(data.data() + 20), bitBytes = getU32(data.data() + 24);
+        if (data.size() - HEADER_BYTES < payload || packedBytes + bitBytes > payload) return 0;
+        if (count > BLOCK_TASKS || suffixBytes > packedBytes * Lz::MAX_EXPANSION) return 0;
 
-        Task nextTask = *this;
-        nextTask.id = nextId++;
-        nextTask.isCompleted = false;
+        const char* body = data.data() + HEADER_BYTES;
+        const char* bits = body + payload - packedBytes - bitBytes;
+        Reader in{(const uint8_t*)body, (const uint8_t*)bits};
+        size_t categories = in.varint();
+        if (categories > payload) return 0;
+        vector<string_view> dictionary(categories);
+        for (auto& category : dictionary) category = in.bytes(in.varint());
+        uint64_t id = in.varint();
+        int32_t due = (int32_t)unzigzag(in.varint()), completed = due;
+        uint64_t base[COLUMNS];
+        int width[COLUMNS];
+        size_t rowBits = 0;
+        for (int c = 0; c < COLUMNS; ++c) {
+            base[c] = in.varint();
+            width[c] = (int)in.varint();
+            if (width[c] > 64) return 0;
+            rowBits += width[c];
+        }
+        if (!in.ok || bitBytes < (count * rowBits + 7) / 8 + BIT_SLACK) return 0;
 
-        // Simple date advancement (basic implementation)
-        time_t now = time(0);
-        tm* ltm = localtime(&now);
+        // Nothing is sized from the header until it is known to be possible:
+        // the varint section holds the categories and odd due dates, each row
+        // adds at most a date and a description, and no description is longer
+        // than all the suffixes or than its shared + rest columns allow
+        auto largest = [&](int c) {
+            uint64_t span = width[c] == 64 ? UINT64_MAX : (uint64_t(1) << width[c]) - 1;
+            return base[c] > UINT64_MAX - span ? UINT64_MAX : base[c] + span;
+        };
+        uint64_t mostShared = largest(SHARED), mostRest = largest(REST);
+        uint64_t description =
+            min<uint64_t>(suffixBytes, mostShared > UINT64_MAX - mostRest ? UINT64_MAX : mostShared + mostRest);
+        if (textBytes > (uint64_t)(bits - body) + count * (10 + description)) return 0;
 
-        if (recurringType == "daily") {
-            ltm->tm_mday += 1;
-        } else if (recurringType == "weekly") {
-            ltm->tm_mday += 7;
-        } else if (recurringType == "monthly") {
-            ltm->tm_mon += 1;
+        if (out.suffixes.size() < suffixBytes + Lz::SLACK) out.suffixes.resize(suffixBytes + Lz::SLACK);
+        if (!Lz::decompress(bits + bitBytes, packedBytes, out.suffixes.data(), suffixBytes)) return 0;
+        out.sourceBytes = getU32(data.data() + 28);
+        out.text.resize(textBytes);
+        out.records.resize(count);
+        char* text = out.text.data();
+        const char* suffix = out.suffixes.data();
+        size_t used = 0, suffixUsed = 0;
+        for (auto& category : dictionary) {
+            if (category.size() > textBytes - used) return 0;
+            memcpy(text + used, category.data(), category.size());
+            category = string_view(text + used, category.size());
+            used += category.size();
         }
 
-        mktime(ltm);
-        ostringstream oss;
-        oss << (1900 + ltm->tm_year) << "-"
-            << setfill('0') << setw(2) << (1 + ltm->tm_mon) << "-"
-            << setfill('0') << setw(2) << ltm->tm_mday;
-        nextTask.dueDate = oss.str();
+        BitReader row{bits};
+        int32_t formatted[DUE_SLOTS];
+        const char* formattedAt[DUE_SLOTS];
+        fill(begin(formatted), end(formatted), Task::NO_DAY);
+        string_view previousDescription;
+        for (TaskRecord& record : out.records) {
+            uint64_t flags = base[FLAGS] + row.get(width[FLAGS]);
+            id += base[ID] + row.get(width[ID]);
+            int64_t dueDelta = unzigzag(base[DUE] + row.get(width[DUE]));
+            int64_t completedDelta = unzigzag(base[COMPLETED_ON] + row.get(width[COMPLETED_ON]));
+            uint64_t category = base[CATEGORY] + row.get(width[CATEGORY]);
+            size_t shared = base[SHARED] + row.get(width[SHARED]);
+            size_t rest = base[REST] + row.get(width[REST]);
+
+            record.id = id;
+            record.priority = flags & PRIORITY ? (int)(flags & PRIORITY) : (int)unzigzag(in.varint());
+            record.isCompleted = flags & COMPLETED;
+            record.dueDate = {};
+            if (flags & DUE_DAY) {
+                due += (int32_t)dueDelta;
+                size_t slot = (uint32_t)due % DUE_SLOTS;
+                if (formatted[slot] != due) {
+                    if (10 > textBytes - used) return 0;
+                    formatted[slot] = due;
+                    formattedAt[slot] = text + used;
+                    DateUtils::formatDay(due, text + used);
+                    used += 10;
+                }
+                record.dueDate = string_view(formattedAt[slot], 10);
+            } else if (flags & DUE_TEXT) {
+                string_view value = in.bytes(in.varint());
+                if (!in.ok || value.size() > textBytes - used) return 0;
+                memcpy(text + used, value.data(), value.size());
+                record.dueDate = string_view(text + used, value.size());
+                used += value.size();
+            }
+            record.completedDay = Task::NO_DAY;
+            if (flags & COMPLETED_DAY) {
+                completed = (int32_t)((flags & DUE_DAY ? due : completed) + completedDelta);
+                record.completedDay = completed;
+            }
+            if (category >= dictionary.size()) return 0;
+            record.category = dictionary[category];
+
+            if (shared > previousDescription.size() || rest > suffixBytes - suffixUsed || shared + rest > textBytes - used) {
+                return 0;
+            }
+            if (shared > 0) memcpy(text + used, previousDescription.data(), shared);
+            memcpy(text + used + shared, suffix + suffixUsed, rest);
+            suffixUsed += rest;
+            record.description = string_view(text + used, shared + rest);
+            used += shared + rest;
+            previousDescription = record.description;
 
-        return nextTask;
+            record.recurrence = RecurrenceRule();
+            if (flags & RECURRING) {
+                RecurrenceRule& rule = record.recurrence;
+                rule.frequency = (RecurrenceRule::Frequency)min<uint64_t>(in.varint(), RecurrenceRule::MONTHLY);
+                rule.interval = (uint16_t)clamp<uint64_t>(in.varint(), 1, 65535);
+                rule.untilDay = (int32_t)unzigzag(in.varint());
+                rule.startDay = (int32_t)unzigzag(in.varint());
+            }
+        }
+        if (!in.ok || used != textBytes || suffixUsed != suffixBytes) return 0;
+        return HEADER_BYTES + payload;
+    }
+
+    // Appends tasks (sorted by id) to the archive at path, BLOCK_TASKS to a
+    // block. sourceBytes is what they took in the task file; the block
+    // headers keep it so the archive can report its compression.
+    // Sets failure and returns false if it can't; an archive damaged short
+    // of its end is left as it is rather than cut back to the damage.
+    static bool append(const string& path, const vector<const Task*>& tasks, size_t sourceBytes, size_t& written,
+                       string& failure) {
+        TRACE_SPAN("archive write", path);
+        string data;
+        for (size_t first = 0; first < tasks.size(); first += BLOCK_TASKS) {
+            size_t last = min(tasks.size(), first + BLOCK_TASKS);
+            vector<const Task*> slice(tasks.begin() + first, tasks.begin() + last);
+            encode(slice, sourceBytes * (last - first) / tasks.size(), data);
+        }
+
+        bool torn;
+        size_t valid = validLength(path, &torn);
+        error_code error;
+        if (filesystem::exists(path, error) && filesystem::file_size(path, error) != valid) {
+            if (!torn) {
+                failure = path + " is damaged at byte " + to_string(valid) + "; not appending to it";
+                return false;
+            }
+            filesystem::resize_file(path, valid, error);
+            if (error) {
+                failure = "could not trim the torn block at the end of " + path;
+                return false;
+            }
+        }
+        failure = "could not write " + path;
+        ofstream out(path, ios::binary | ios::app);
+        if (!out.is_open()) return false;
+        out.write(data.data(), (streamsize)data.size());
+        out.close();
+        if (out.fail()) return false;
+        failure.clear();
+        if (Journal::policy().mode != Journal::NONE) Journal::syncPath(path);
+        written = data.size();
+        return true;
+    }
+
+    // Calls fn(record) for every archived task, block by block. The record's
+    // views last until fn returns. False if the file can't be read or holds a
+    // damaged block; a torn block at the end is skipped.
+    template <class Fn>
+    static bool forEach(const string& path, Fn fn) {
+        TRACE_SPAN("archive read", path);
+        string data;
+        if (!TaskFile::readAll(path, data)) return false;
+        string_view rest = data;
+        Block block;
+        while (rest.size() >= HEADER_BYTES) {
+            size_t used = decode(rest, block);
+            if (used == 0) return rest.size() < HEADER_BYTES + getU32(rest.data() + 4);
+            for (const auto& record : block.records) fn(record);
+            rest.remove_prefix(used);
+        }
+        return true;
+    }
+
+    // Block count and sizes from the headers alone
+    static Stats stats(const string& path) {
+        Stats result;
+        size_t valid = validLength(path);
+        ifstream in(path, ios::binary);
+        char header[HEADER_BYTES];
+        while (result.fileBytes < valid && in.read(header, HEADER_BYTES)) {
+            result.blocks++;
+            result.tasks += getU32(header + 8);
+            result.sourceBytes += getU32(header + 28);
+            result.fileBytes += HEADER_BYTES + getU32(header + 4);
+            in.seekg((streamoff)result.fileBytes);
+        }
+        return result;
     }
-};
 
-int Task::nextId = 1;
+    // Moves completed tasks whose completion date is before beforeDay (or
+    // unknown) out of the store and into owner_archive.bin. The archive is
+    // written and synced before the tasks are removed, so a crash in between
+    // leaves them in both places rather than in neither.
+    static Report archiveCompleted(TaskStore& store, int32_t beforeDay) {
+        Report report;
+        auto old = [&](const Task& task) { return task.getIsCompleted() && task.getCompletedDay() < beforeDay; };
+        vector<const Task*> picked;
+        ostringstream line;
+        for (const auto& task : store.tasks) {
+            if (task.getIsDeleted() || !old(task)) continue;
+            picked.push_back(&task);
+            line.str("");
+            TaskStore::writeTask(line, task);
+            report.sourceBytes += (size_t)line.tellp();
+        }
+        if (picked.empty()) return report;
+        sort(picked.begin(), picked.end(), [](const Task* a, const Task* b) { return a->getId() < b->getId(); });
+
+        string path = store.getOwner() + "_archive.bin";
+        if (!append(path, picked, report.sourceBytes, report.archiveBytes, report.failure)) return report;
+        report.archived = store.removeWhere(old);
+        store.compactIfNeeded();
+        return report;
+    }
+};
 
 // User class for multi-user support
 class User {
@@ -166,64 +5338,364 @@ public:
     bool authenticate(const string& pass) const { return password == pass; }
 };
 
+// Disk-backed user directory. users.txt stays the append-only list of
+// "username|password" records; users.idx is an open-addressing hash table of
+// byte offsets into it, so a lookup or registration reads a couple of records
+// instead of the whole file. A missing index is rebuilt from users.txt once,
+// and records appended behind its back are indexed on open.
+class UserDirectory {
+private:
+    struct IndexHeader {
+        char magic[8];
+        uint64_t bucketCount;  // power of two
+        uint64_t entryCount;
+        uint64_t indexedBytes; // prefix of users.txt covered by the table
+    };
+
+    static constexpr char INDEX_MAGIC[8] = {'T', 'R', 'U', 'I', 'D', 'X', '1', '\0'};
+    static constexpr uint64_t MIN_BUCKETS = 1024;
+
+    string usersPath, indexPath;
+    fstream users, index;
+    IndexHeader header{};
+
+    // FNV-1a; unlike std::hash it is stable across builds, which an on-disk table needs
+    static uint64_t hashName(string_view name) {
+        uint64_t h = 1469598103934665603ull;
+        for (char c : name) {
+            h ^= (unsigned char)c;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    static string_view nameOf(string_view record) {
+        return record.substr(0, record.find('|'));
+    }
+
+    static void openOrCreate(fstream& file, const string& path) {
+        file.open(path, ios::in | ios::out | ios::binary);
+        if (!file.is_open()) {
+            ofstream(path, ios::binary).close();
+            file.open(path, ios::in | ios::out | ios::binary);
+        }
+    }
+
+    static uint64_t sizeOf(fstream& file) {
+        file.clear();
+        file.seekg(0, ios::end);
+        return (uint64_t)file.tellg();
+    }
+
+    bool readRecord(uint64_t offset, string& record) {
+        users.clear();
+        users.seekg((streamoff)offset);
+        if (!getline(users, record)) return false;
+        if (!record.empty() && record.back() == '\r') record.pop_back();
+        return true;
+    }
+
+    uint64_t readBucket(uint64_t slot) {
+        uint64_t entry = 0;
+        index.clear();
+        index.seekg((streamoff)(sizeof(IndexHeader) + slot * sizeof(entry)));
+        index.read((char*)&entry, sizeof(entry));
+        return entry;
+    }
+
+    void writeBucket(uint64_t slot, uint64_t entry) {
+        index.clear();
+        index.seekp((streamoff)(sizeof(IndexHeader) + slot * sizeof(entry)));
+        index.write((const char*)&entry, sizeof(entry));
+    }
+
+    void writeHeader() {
+        index.clear();
+        index.seekp(0);
+        index.write((const char*)&header, sizeof(header));
+        index.flush();
+    }
+
+    // Linear probing; returns the slot holding name, or the empty slot where it belongs.
+    // Buckets store offset + 1 so that zero can mean empty.
+    uint64_t probe(string_view name, bool& found, string* record) {
+        uint64_t mask = header.bucketCount - 1;
+        string candidate;
+        for (uint64_t slot = hashName(name) & mask;; slot = (slot + 1) & mask) {
+            uint64_t entry = readBucket(slot);
+            if (entry == 0) {
+                found = false;
+                return slot;
+            }
+            if (readRecord(entry - 1, candidate) && nameOf(candidate) == name) {
+                found = true;
+                if (record) *record = std::move(candidate);
+                return slot;
+            }
+        }
+    }
+
+    // Indexes every record from byte `from` to the end of users.txt. The
+    // first registration of a name wins, as it did with the in-memory map.
+    void indexFrom(uint64_t from) {
+        vector<pair<string, uint64_t>> pending;
+        users.clear();
+        users.seekg((streamoff)from);
+        string line;
+        uint64_t offset = from;
+        while (getline(users, line)) {
+            string_view name = nameOf(line);
+            if (!name.empty()) pending.emplace_back(string(name), offset);
+            offset = (uint64_t)users.tellg();
+        }
+        if (users.eof()) offset = sizeOf(users);
+
+        for (const auto& entry : pending) {
+            if ((header.entryCount + 1) * 10 > header.bucketCount * 7) {
+                rebuild(header.bucketCount * 2);
+                return;
+            }
+            bool found;
+            uint64_t slot = probe(entry.first, found, nullptr);
+            if (!found) {
+                writeBucket(slot, entry.second + 1);
+                header.entryCount++;
+            }
+        }
+        header.indexedBytes = offset;
+        writeHeader();
+    }
+
+    void rebuild(uint64_t buckets) {
+        index.close();
+        {
+            ofstream fresh(indexPath, ios::binary | ios::trunc);
+            header = IndexHeader{};
+            memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+            header.bucketCount = buckets;
+            fresh.write((const char*)&header, sizeof(header));
+            vector<char> zeros(64 * 1024, 0);
+            for (uint64_t left = buckets * sizeof(uint64_t); left > 0;) {
+                size_t n = (size_t)min<uint64_t>(left, zeros.size());
+                fresh.write(zeros.data(), (streamsize)n);
+                left -= n;
+            }
+        }
+        openOrCreate(index, indexPath);
+        indexFrom(0);
+    }
+
+public:
+    UserDirectory(const string& usersFile, const string& indexFile) : usersPath(usersFile), indexPath(indexFile) {
+        openOrCreate(users, usersPath);
+        openOrCreate(index, indexPath);
+
+        index.clear();
+        index.seekg(0);
+        bool valid = index.read((char*)&header, sizeof(header)) &&
+                     memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+                     header.bucketCount >= MIN_BUCKETS && (header.bucketCount & (header.bucketCount - 1)) == 0;
+        uint64_t size = sizeOf(users);
+        if (!valid || header.indexedBytes > size) {
+            rebuild(MIN_BUCKETS);
+        } else if (header.indexedBytes < size) {
+            indexFrom(header.indexedBytes);
+        }
+    }
+
+    bool find(const string& username, User& user) {
+        TRACE_SPAN("user lookup", username);
+        if (username.empty()) return false;
+        bool found;
+        string record;
+        probe(username, found, &record);
+        if (!found) return false;
+
+        size_t bar = record.find('|');
+        user = User(username, bar == string::npos ? "" : record.substr(bar + 1));
+        return true;
+    }
+
+    bool add(const string& username, const string& password) {
+        if (username.empty() || username.find_first_of("|\n") != string::npos) return false;
+        bool found;
+        probe(username, found, nullptr);
+        if (found) return false;
+
+        uint64_t offset = sizeOf(users);
+        users.clear();
+        if (offset > 0) {
+            char last = 0;
+            users.seekg((streamoff)offset - 1);
+            users.get(last);
+            users.clear();
+            if (last != '\n') {
+                users.seekp((streamoff)offset);
+                users.put('\n');
+                offset++;
+            }
+        }
+        users.seekp((streamoff)offset);
+        users << username << "|" << password << "\n";
+        users.flush();
+
+        indexFrom(offset);
+        return true;
+    }
+
+    // Calls fn(username) for every account, in registration order
+    template <class F>
+    void forEach(F fn) {
+        users.clear();
+        users.seekg(0);
+        string line;
+        while (getline(users, line)) {
+            string_view name = nameOf(line);
+            if (!name.empty()) fn(name);
+        }
+    }
+};
+
 // Action class for undo functionality
 class Action {
 public:
-    enum Type { ADD, DELETE, COMPLETE, EDIT };
+    enum Type { ADD, DELETE, COMPLETE, EDIT, BULK_COMPLETE, BULK_DELETE };
     Type type;
     Task task;
     int index;
+    vector<pair<int, Task>> group; // bulk actions: every affected task and its position
 
     Action(Type t, const Task& tsk, int idx = -1) : type(t), task(tsk), index(idx) {}
+    Action(Type t, vector<pair<int, Task>> affected)
+        : type(t), task(0, "", 0, ""), index(-1), group(std::move(affected)) {}
+
+    // Copy whose tasks allocate their strings from alloc, so the undo
+    // history's memory can be counted
+    Action(const Action& other, const Task::allocator_type& alloc)
+        : type(other.type), task(other.task, alloc), index(other.index) {
+        group.reserve(other.group.size());
+        for (const auto& [position, affected] : other.group) group.emplace_back(position, Task(affected, alloc));
+    }
+
+    Action(const Action&) = default;
+    Action(Action&&) = default;
+    Action& operator=(const Action&) = default;
+    Action& operator=(Action&&) = default;
 };
 
 // Enhanced ToDoList class
 class ToDoList {
 private:
-    vector<Task> tasks;
+    TaskStore store;
+    CountingResource historyMemory; // strings of the task copies kept for undo
     vector<Action> actionHistory;
-    map<string, User> users;
+    UserDirectory users{"users.txt", "users.idx"};
     string currentUser;
     const int MAX_HISTORY = 10;
+    static constexpr size_t REPORT_BATCH_USERS = 1024; // users whose files the all-users report holds at once
+    enum UserFile { TASKS, SEALED, JOURNAL, USER_FILES }; // what readUserFiles reads per user, in order
+    unsigned workerThreads = max(1u, thread::hardware_concurrency());
+    unique_ptr<ThreadPool> pool;
+    TaskFile::Summary loginSummary;
+    future<void> pendingLoad; // last member: its destructor waits for the load before the store goes away
 
 public:
-    ToDoList() {
-        loadUsers();
-    }
-
-    ~ToDoList() {
-        saveUsers();
-    }
-
     // User management
     bool registerUser(const string& username, const string& password) {
-        if (users.find(username) != users.end()) {
-            return false; // User already exists
-        }
-        users.insert(make_pair(username, User(username, password)));
-        return true;
+        return users.add(username, password); // false if the user already exists
+    }
+
+    bool authenticate(const string& username, const string& password) {
+        User user;
+        return users.find(username, user) && user.authenticate(password);
     }
 
-    bool loginUser(const string& username, const string& password) {
-        auto it = users.find(username);
-        if (it != users.end() && it->second.authenticate(password)) {
+    // With loadInBackground, only the task file's summary block is read here
+    // and the full load runs on another thread, so the banner and reminders
+    // don't wait for it; anything else that touches the list must call
+    // waitForLoad() first.
+    bool loginUser(const string& username, const string& password, bool loadInBackground = false) {
+        TRACE_SPAN("login", username);
+        if (authenticate(username, password)) {
             currentUser = username;
-            loadTasks();
+            TaskFile::readSummary(username + "_tasks.txt", loginSummary);
+            // Changes since the summary was written would make it stale; wait for the load instead
+            if (TaskStore::hasJournalRecords(username)) loginSummary.present = false;
+            if (loadInBackground) {
+                pendingLoad = async(launch::async, [this, username] { store.open(username, parallelPool()); });
+            } else {
+                store.open(username, parallelPool());
+            }
             return true;
         }
         return false;
     }
 
+    bool isLoaded() const {
+        return !pendingLoad.valid() || pendingLoad.wait_for(chrono::seconds(0)) == future_status::ready;
+    }
+
+    void waitForLoad() {
+        if (pendingLoad.valid()) pendingLoad.get();
+    }
+
+    // Login banner and reminders. While the list is still loading they come
+    // from the summary block, which costs the same however many tasks there are.
+    void showLoginSummary() {
+        if (isLoaded() || !loginSummary.present) {
+            waitForLoad();
+            cout << "You have " << store.liveCount() << " task(s).\n";
+            showReminders();
+            return;
+        }
+
+        const TaskFile::Summary& summary = loginSummary;
+        cout << "You have " << summary.total << " task(s), " << summary.pending << " pending.\n";
+        cout << "\n===== Reminders =====\n";
+        string today(DateUtils::today());
+        vector<const TaskFile::Summary::Upcoming*> overdue, dueSoon;
+        for (const auto& task : summary.upcoming) {
+            if (task.dueDate < today) overdue.push_back(&task);
+            else if (DateUtils::isDueSoon(task.dueDate)) dueSoon.push_back(&task);
+        }
+
+        auto print = [](const char* marker, const TaskFile::Summary::Upcoming& task) {
+            cout << marker << task.description << " (Priority: " << Task::priorityName(task.priority)
+                 << ", Due: " << task.dueDate << ")\n";
+        };
+        if (!overdue.empty()) {
+            cout << "OVERDUE TASKS:\n";
+            for (const auto* task : overdue) print("⚠️  ", *task);
+        }
+        if (!dueSoon.empty()) {
+            cout << "\nDUE SOON (next 3 days):\n";
+            for (const auto* task : dueSoon) print("⏰ ", *task);
+        }
+        if (overdue.empty() && dueSoon.empty()) {
+            cout << "No urgent tasks. Great job! 🎉\n";
+        } else if (overdue.size() + dueSoon.size() == TaskFile::SUMMARY_TASKS) {
+            cout << "(The " << TaskFile::SUMMARY_TASKS << " soonest are shown; use Show Reminders for all.)\n";
+        }
+    }
+
     void logoutUser() {
+        waitForLoad();
         if (!currentUser.empty()) {
-            saveTasks();
+            store.save();
             currentUser = "";
-            tasks.clear();
+            store.close();
             actionHistory.clear();
         }
     }
 
     bool isLoggedIn() const { return !currentUser.empty(); }
+
+    // Number of threads used by the parallel load and search paths
+    void setWorkerThreads(unsigned count) {
+        workerThreads = max(1u, count);
+        pool.reset();
+    }
+    unsigned getWorkerThreads() const { return workerThreads; }
     string getCurrentUser() const { return currentUser; }
 
     // Enhanced task management
@@ -260,8 +5732,7 @@ public:
         getline(cin, category);
         if (category.empty()) category = "General";
 
-        Task newTask(desc, prio, due, category);
-
+        RecurrenceRule rule;
         cout << "Is this a recurring task? (y/n): ";
         cin >> recurring;
         if (recurring == 'y' || recurring == 'Y') {
@@ -269,19 +5740,41 @@ public:
             cout << "Recurring type: 1. Daily 2. Weekly 3. Monthly: ";
             cin >> recurType;
             switch (recurType) {
-                case 1: newTask.setRecurring("daily"); break;
-                case 2: newTask.setRecurring("weekly"); break;
-                case 3: newTask.setRecurring("monthly"); break;
+                case 1: rule.frequency = RecurrenceRule::DAILY; break;
+                case 2: rule.frequency = RecurrenceRule::WEEKLY; break;
+                case 3: rule.frequency = RecurrenceRule::MONTHLY; break;
             }
         }
 
-        tasks.push_back(newTask);
+        if (rule.active()) {
+            int interval;
+            cout << "Repeat every how many " << (rule.frequency == RecurrenceRule::DAILY ? "days"
+                    : rule.frequency == RecurrenceRule::WEEKLY ? "weeks" : "months") << "? (1-365): ";
+            while (!(cin >> interval) || interval < 1 || interval > 365) {
+                cout << "Invalid input. Please enter a number from 1 to 365: ";
+                cin.clear();
+                cin.ignore(10000, '\n');
+            }
+            cin.ignore();
+            rule.interval = (uint16_t)interval;
+            DateUtils::toDayNumber(due, rule.startDay);
+
+            string until;
+            cout << "End date (YYYY-MM-DD, or press Enter for none): ";
+            getline(cin, until);
+            while (!until.empty() && !DateUtils::toDayNumber(until, rule.untilDay)) {
+                cout << "Invalid date. Please use YYYY-MM-DD or press Enter for none: ";
+                getline(cin, until);
+            }
+        }
+
+        Task& newTask = store.add(desc, prio, due, category, rule);
         addToHistory(Action::ADD, newTask);
         cout << "Task added successfully!\n";
     }
 
     void editTask() {
-        if (tasks.empty()) {
+        if (store.empty()) {
             cout << "No tasks to edit.\n";
             return;
         }
@@ -291,12 +5784,12 @@ public:
         cout << "Enter task number to edit: ";
         cin >> idx;
 
-        if (idx < 1 || idx > (int)tasks.size()) {
+        if (idx < 1 || !store.isLive(idx - 1)) {
             cout << "Invalid task number.\n";
             return;
         }
 
-        Task oldTask = tasks[idx - 1];
+        Task oldTask = store.tasks[idx - 1];
 
         cout << "What would you like to edit?\n";
         cout << "1. Description\n2. Priority\n3. Due Date\n4. Category\n";
@@ -311,7 +5804,7 @@ public:
                 string newDesc;
                 cout << "Enter new description: ";
                 getline(cin, newDesc);
-                tasks[idx - 1].setDescription(newDesc);
+                store.modify(idx - 1).setDescription(newDesc);
                 break;
             }
             case 2: {
@@ -320,7 +5813,7 @@ public:
                     cout << "Enter new priority (1-3): ";
                     cin >> newPrio;
                 } while (newPrio < 1 || newPrio > 3);
-                tasks[idx - 1].setPriority(newPrio);
+                store.modify(idx - 1).setPriority(newPrio);
                 break;
             }
             case 3: {
@@ -329,14 +5822,21 @@ public:
                     cout << "Enter new due date (YYYY-MM-DD): ";
                     cin >> newDate;
                 } while (!DateUtils::isValidDate(newDate));
-                tasks[idx - 1].setDueDate(newDate);
+                Task& task = store.modify(idx - 1);
+                task.setDueDate(newDate);
+                // Re-anchor the series so later occurrences follow the new date
+                if (task.getIsRecurring()) {
+                    RecurrenceRule rule = task.getRecurrence();
+                    DateUtils::toDayNumber(newDate, rule.startDay);
+                    task.setRecurrence(rule);
+                }
                 break;
             }
             case 4: {
                 string newCategory;
                 cout << "Enter new category: ";
                 getline(cin, newCategory);
-                tasks[idx - 1].setCategory(newCategory);
+                store.modify(idx - 1).setCategory(newCategory);
                 break;
             }
             default:
@@ -344,23 +5844,25 @@ public:
                 return;
         }
 
+        store.markDirty(idx - 1);
         addToHistory(Action::EDIT, oldTask, idx - 1);
         cout << "Task updated successfully!\n";
     }
 
     void searchTasks() {
-        if (tasks.empty()) {
+        if (store.empty()) {
             cout << "No tasks to search.\n";
             return;
         }
 
-        cout << "Search by: 1. Description 2. Category 3. Priority 4. Status\n";
+        cout << "Search by: 1. Description 2. Category 3. Priority 4. Status 5. Query\n";
         cout << "Choose option: ";
         int choice;
         cin >> choice;
         cin.ignore();
 
         vector<int> results;
+        string today = DateUtils::getCurrentDate();
 
         switch (choice) {
             case 1: {
@@ -369,13 +5871,10 @@ public:
                 getline(cin, keyword);
                 transform(keyword.begin(), keyword.end(), keyword.begin(), ::tolower);
 
-                for (size_t i = 0; i < tasks.size(); ++i) {
-                    string desc = tasks[i].getDescription();
-                    transform(desc.begin(), desc.end(), desc.begin(), ::tolower);
-                    if (desc.find(keyword) != string::npos) {
-                        results.push_back(i);
-                    }
-                }
+                Perf::Timer timer(Perf::SEARCH_DESCRIPTION);
+                results = store.scan([&](const Task& task) {
+                    return StringUtils::containsIgnoreCase(task.getDescription(), keyword);
+                }, parallelPool());
                 break;
             }
             case 2: {
@@ -383,11 +5882,9 @@ public:
                 cout << "Enter category: ";
                 getline(cin, category);
 
-                for (size_t i = 0; i < tasks.size(); ++i) {
-                    if (tasks[i].getCategory() == category) {
-                        results.push_back(i);
-                    }
-                }
+                Perf::Timer timer(Perf::SEARCH_CATEGORY);
+                results = store.scan([&](const Task& task) { return task.getCategory() == category; },
+                                     parallelPool());
                 break;
             }
             case 3: {
@@ -395,11 +5892,9 @@ public:
                 cout << "Enter priority (1-3): ";
                 cin >> priority;
 
-                for (size_t i = 0; i < tasks.size(); ++i) {
-                    if (tasks[i].getPriority() == priority) {
-                        results.push_back(i);
-                    }
-                }
+                Perf::Timer timer(Perf::SEARCH_PRIORITY);
+                results = store.scan([&](const Task& task) { return task.getPriority() == priority; },
+                                     parallelPool());
                 break;
             }
             case 4: {
@@ -407,11 +5902,27 @@ public:
                 int status;
                 cin >> status;
 
-                for (size_t i = 0; i < tasks.size(); ++i) {
-                    if (status == 1 && tasks[i].getIsCompleted()) results.push_back(i);
-                    else if (status == 2 && !tasks[i].getIsCompleted() && !tasks[i].isOverdue()) results.push_back(i);
-                    else if (status == 3 && tasks[i].isOverdue()) results.push_back(i);
+                Perf::Timer timer(Perf::SEARCH_STATUS);
+                results = store.scan([&](const Task& task) {
+                    if (status == 1) return task.getIsCompleted();
+                    if (status == 2) return !task.getIsCompleted() && !task.isOverdue(today);
+                    if (status == 3) return task.isOverdue(today);
+                    return false;
+                }, parallelPool());
+                break;
+            }
+            case 5: {
+                string text, error, plan;
+                cout << "Enter query (e.g. category:Work priority<=2 due:2025-06-01..2025-06-30 "
+                        "status:pending \"report\" sort:due): ";
+                getline(cin, text);
+                TaskQuery query;
+                if (!query.parse(text, error)) {
+                    cout << "Invalid query: " << error << "\n";
+                    return;
                 }
+                results = store.query(query, parallelPool(), &plan);
+                cout << "Plan: " << plan << "\n";
                 break;
             }
         }
@@ -419,6 +5930,7 @@ public:
         if (results.empty()) {
             cout << "No matching tasks found.\n";
         } else {
+            TRACE_SPAN("render results");
             cout << "\nSearch Results:\n";
             for (int idx : results) {
                 displayTask(idx);
@@ -427,52 +5939,327 @@ public:
     }
 
     void showStatistics() {
-        if (tasks.empty()) {
+        if (store.empty()) {
             cout << "No tasks to analyze.\n";
             return;
         }
 
-        int completed = 0, pending = 0, overdue = 0;
-        int high = 0, medium = 0, low = 0;
-        map<string, int> categoryCount;
+        TaskStats stats = store.stats(parallelPool());
 
-        for (const auto& task : tasks) {
-            if (task.getIsCompleted()) completed++;
-            else if (task.isOverdue()) overdue++;
-            else pending++;
+        TRACE_SPAN("render statistics");
+        cout << "\n===== Task Statistics =====\n";
+        stats.print();
+        showTrends();
+    }
+
+    // Velocity, streaks and a weekly history from the per-day counters
+    void showTrends() const {
+        const TrendCounters& trends = store.trends();
+        if (trends.empty()) return;
+
+        int32_t today = DateUtils::todayNumber();
+        auto completed = [&](int32_t from, int32_t to) { return trends.total(TrendCounters::COMPLETED, from, to); };
+        auto created = [&](int32_t from, int32_t to) { return trends.total(TrendCounters::CREATED, from, to); };
+        auto perDay = [](int64_t count, int days) {
+            ostringstream out;
+            out << fixed << setprecision(1) << (double)count / days;
+            return out.str();
+        };
+
+        cout << "\n===== Trends =====\n";
+        int64_t lastWeek = completed(today - 6, today), weekBefore = completed(today - 13, today - 7);
+        cout << "Completed per day: " << perDay(lastWeek, 7) << " (7 days), "
+             << perDay(completed(today - 29, today), 30) << " (30 days)\n";
+        cout << "This week vs last: " << lastWeek << " vs " << weekBefore << " completed\n";
+        cout << "Last 30 days: " << created(today - 29, today) << " created, " << completed(today - 29, today)
+             << " completed\n";
+        cout << "Streak: " << trends.streak(today) << " day(s), longest " << trends.longestStreak() << "\n";
+
+        cout << "\nWeek starting   Created  Completed  Overdue\n";
+        char date[10];
+        for (int week = 7; week >= 0; --week) {
+            int32_t to = today - 7 * week, from = to - 6;
+            int32_t overdue = trends.lastOverdue(from, to);
+            cout << DateUtils::formatDay(from, date) << "   " << setw(7) << created(from, to) << "  "
+                 << setw(9) << completed(from, to) << "  " << setw(7);
+            if (overdue == TrendCounters::NO_SAMPLE) cout << "-";
+            else cout << overdue;
+            cout << "\n";
+        }
+    }
+
+    // Admin report over every account in users.txt. The files are read
+    // REPORT_BATCH_USERS at a time as one AsyncIo batch, then parsed and
+    // reduced on the pool with each user's journal applied; the per-user
+    // results are merged at the end.
+    void showAllUsersReport() {
+        vector<string> names;
+        users.forEach([&](string_view name) { names.emplace_back(name); });
+
+        string today = DateUtils::getCurrentDate();
+        vector<TaskStats> perUser(names.size());
+        for (size_t first = 0; first < names.size(); first += REPORT_BATCH_USERS) {
+            size_t count = min(REPORT_BATCH_USERS, names.size() - first);
+            vector<AsyncIo::Op> files = readUserFiles(names, first, count);
+            workers().parallelFor(count, [&](size_t i) {
+                const AsyncIo::Op* mine = &files[i * USER_FILES];
+                if (!mine[TASKS].ok) return;
+                string_view text = mine[TASKS].contents;
+                TaskFile::readHeader(text);
+
+                JournalOverlay journal(mine[SEALED].contents, mine[JOURNAL].contents);
+                StatsPartial partial;
+                journal.forEachRecord(text, [&](const TaskRecord& record) { partial.add(record, today); });
+                perUser[first + i].merge(partial);
+            });
+        }
+
+        TaskStats combined;
+        cout << "\n===== All Users Report =====\n";
+        for (size_t i = 0; i < names.size(); ++i) {
+            cout << names[i] << ": " << perUser[i].total << " tasks, " << perUser[i].completed
+                 << " completed, " << perUser[i].overdue << " overdue\n";
+            combined.merge(perUser[i]);
+        }
+        cout << "\nUsers: " << names.size() << "\n";
+        combined.print();
+    }
 
-            switch (task.getPriority()) {
-                case 1: high++; break;
-                case 2: medium++; break;
-                case 3: low++; break;
+    // Every account's tasks in one Arrow file with a user column. Files are
+    // read REPORT_BATCH_USERS at a time as one AsyncIo batch, like the
+    // all-users report; each user's lines, with their journal applied, are
+    // parsed straight into the columns in users.txt order and the user's
+    // buffers freed after.
+    bool exportAllUsersArrow(const string& path) {
+        vector<string> names;
+        users.forEach([&](string_view name) { names.emplace_back(name); });
+
+        ArrowExport arrow(true);
+        for (size_t first = 0; first < names.size(); first += REPORT_BATCH_USERS) {
+            size_t count = min(REPORT_BATCH_USERS, names.size() - first);
+            vector<AsyncIo::Op> files = readUserFiles(names, first, count);
+            for (size_t i = 0; i < count; ++i) {
+                int32_t user = arrow.addUser(names[first + i]);
+                AsyncIo::Op* mine = &files[i * USER_FILES];
+                if (mine[TASKS].ok) {
+                    string_view text = mine[TASKS].contents;
+                    TaskFile::readHeader(text);
+                    JournalOverlay journal(mine[SEALED].contents, mine[JOURNAL].contents);
+                    journal.forEachRecord(text, [&](const TaskRecord& record) { arrow.add(record, user); });
+                }
+                for (size_t f = 0; f < USER_FILES; ++f) string().swap(mine[f].contents);
             }
+        }
+        if (!arrow.write(path)) {
+            cerr << "Could not write " << path << ".\n";
+            return false;
+        }
+        cout << "Exported " << arrow.rows() << " task(s) from " << names.size() << " user(s) to " << path << ".\n";
+        return true;
+    }
 
-            categoryCount[task.getCategory()]++;
+    void importExport() {
+        cout << "1. Export tasks 2. Import tasks 3. Columnar export (Arrow IPC file)\n";
+        cout << "4. Archive completed tasks 5. Search archive\n";
+        cout << "Choose option: ";
+        int choice;
+        cin >> choice;
+        cin.ignore();
+        if (choice < 1 || choice > 5) {
+            cout << "Invalid option.\n";
+            return;
+        }
+        if (choice == 4) {
+            archiveCompleted();
+            return;
+        }
+        if (choice == 5) {
+            searchArchive();
+            return;
         }
 
-        cout << "\n===== Task Statistics =====\n";
-        cout << "Total Tasks: " << tasks.size() << "\n";
-        cout << "Completed: " << completed << " (" << (completed * 100 / (int)tasks.size()) << "%)\n";
-        cout << "Pending: " << pending << "\n";
-        cout << "Overdue: " << overdue << "\n\n";
+        string path;
+        if (choice == 3) {
+            cout << "File path (e.g. tasks.arrow): ";
+            getline(cin, path);
+            if (path.empty()) {
+                cout << "No file given.\n";
+                return;
+            }
+            ArrowExport arrow;
+            for (const auto& task : store.tasks) arrow.add(task);
+            if (arrow.write(path)) {
+                cout << "Exported " << arrow.rows() << " task(s) to " << path << ".\n";
+            } else {
+                cout << "Could not write " << path << ".\n";
+            }
+            return;
+        }
 
-        cout << "Priority Distribution:\n";
-        cout << "High: " << high << ", Medium: " << medium << ", Low: " << low << "\n\n";
+        cout << "File path (.csv for CSV, anything else for JSON lines): ";
+        getline(cin, path);
+        if (path.empty()) {
+            cout << "No file given.\n";
+            return;
+        }
+        TaskExchange::Format format = TaskExchange::formatFor(path);
 
-        cout << "Tasks by Category:\n";
-        for (const auto& pair : categoryCount) {
-            cout << pair.first << ": " << pair.second << "\n";
+        if (choice == 1) {
+            size_t written;
+            if (TaskExchange::exportTasks(store, path, format, written)) {
+                cout << "Exported " << written << " task(s) to " << path << ".\n";
+            } else {
+                cout << "Could not write " << path << ".\n";
+            }
+            return;
+        }
+
+        TaskExchange::ImportReport report = TaskExchange::importTasks(store, path, format);
+        cout << "Imported " << report.imported << " task(s)";
+        if (report.rejected > 0) cout << ", rejected " << report.rejected;
+        cout << ".\n";
+        for (const auto& error : report.errors) cout << "  " << error << "\n";
+        if (!report.failure.empty()) cout << "Import stopped: " << report.failure << "\n";
+    }
+
+    // Moves completed tasks out of the task file into the compressed archive
+    void archiveCompleted() {
+        cout << "Archive tasks completed before (YYYY-MM-DD, Enter for all): ";
+        string date;
+        getline(cin, date);
+        int32_t before = INT32_MAX;
+        if (!date.empty() && !DateUtils::toDayNumber(date, before)) {
+            cout << "Invalid date.\n";
+            return;
+        }
+
+        TaskArchive::Report report = TaskArchive::archiveCompleted(store, before);
+        if (!report.failure.empty()) {
+            cout << "Archive failed: " << report.failure << "\n";
+        } else if (report.archived == 0) {
+            cout << "No completed tasks to archive.\n";
+        } else {
+            cout << "Archived " << report.archived << " task(s): " << StringUtils::formatBytes(report.sourceBytes)
+                 << " of task file stored in " << StringUtils::formatBytes(report.archiveBytes) << ".\n";
+        }
+    }
+
+    void searchArchive() {
+        string path = currentUser + "_archive.bin";
+        TaskArchive::Stats stats = TaskArchive::stats(path);
+        if (stats.tasks == 0) {
+            cout << "The archive is empty.\n";
+            return;
+        }
+        ostringstream ratio;
+        ratio << fixed << setprecision(1) << (double)stats.sourceBytes / max<size_t>(1, stats.fileBytes);
+        cout << "Archive: " << stats.tasks << " task(s) in " << stats.blocks << " block(s), "
+             << StringUtils::formatBytes(stats.fileBytes) << " (compression ratio " << ratio.str() << "x)\n";
+        cout << "Search archived descriptions for: ";
+        string keyword;
+        getline(cin, keyword);
+        transform(keyword.begin(), keyword.end(), keyword.begin(), ::tolower);
+
+        size_t found = 0;
+        bool intact = TaskArchive::forEach(path, [&](const TaskRecord& record) {
+            if (!StringUtils::containsIgnoreCase(record.description, keyword)) return;
+            char day[10];
+            cout << "#" << record.id << " [✓] " << record.description << " (Priority: "
+                 << Task::priorityName(record.priority) << ", Due: " << record.dueDate
+                 << ", Category: " << record.category;
+            if (record.completedDay != Task::NO_DAY) cout << ", Completed: " << DateUtils::formatDay(record.completedDay, day);
+            cout << ")\n";
+            found++;
+        });
+        cout << found << " archived task(s) found.\n";
+        if (!intact) cout << "The archive has a damaged block; tasks after it could not be read.\n";
+    }
+
+    void showPerformance() {
+        cout << "\n===== Performance (since startup) =====\n";
+        Perf::print(cout);
+        cout << "Journal durability: " << Journal::policy().describe() << "\n";
+        cout << "Batched I/O: " << AsyncIo::describe() << "\n";
+        cout << "Write as JSON to file (Enter to skip): ";
+        string path;
+        getline(cin, path);
+        if (path.empty()) return;
+        ofstream out(path);
+        if (!out.is_open()) {
+            cout << "Could not write " << path << ".\n";
+            return;
+        }
+        Perf::writeJson(out);
+        out << "\n";
+        cout << "Wrote " << path << ".\n";
+    }
+
+    // Undo history: the Action slots, the task slots of bulk actions, and the
+    // strings of every task copy (counted by historyMemory)
+    size_t historyBytes() const {
+        size_t bytes = actionHistory.capacity() * sizeof(Action) + historyMemory.bytesInUse();
+        for (const auto& action : actionHistory) bytes += action.group.capacity() * sizeof(pair<int, Task>);
+        return bytes;
+    }
+
+    void showMemoryReport() const {
+        TaskStore::MemoryReport report = store.memoryReport();
+        size_t history = historyBytes();
+        auto line = [](const char* label, size_t bytes) {
+            cout << left << setw(28) << label << right << setw(12) << StringUtils::formatBytes(bytes) << "\n";
+        };
+
+        cout << "\n===== Memory Report =====\n";
+        cout << report.liveTasks << " task(s) in " << report.slots << " slot(s), " << sizeof(Task)
+             << " bytes per task object\n\n";
+        line("Task objects", report.taskObjects);
+        line("Description strings", report.descriptions);
+        line("Category strings", report.categories);
+        line("Due date strings", report.dueDates);
+        line("Allocator overhead", report.arenaOverhead);
+        line("  Arena total", report.arenaReserved);
+        line("Indexes", report.indexes);
+        line("Trend counters and scratch", report.other);
+        line("Undo history", history);
+        line("Total", report.total() + history);
+        cout << "(Strings short enough to be stored inside a task object take no extra space.)\n";
+    }
+
+    void showTopUrgent() {
+        int count;
+        cout << "How many tasks? ";
+        if (!(cin >> count) || count < 1) {
+            cout << "Invalid number.\n";
+            cin.clear();
+            cin.ignore(10000, '\n');
+            return;
+        }
+        cin.ignore();
+
+        const auto& top = store.topUrgent((size_t)count);
+        if (top.empty()) {
+            cout << "No pending tasks.\n";
+            return;
+        }
+        cout << "\n===== Top " << top.size() << " Most Urgent =====\n";
+        for (const auto& entry : top) {
+            cout << "[" << setw(3) << entry.score << "] ";
+            displayTask(entry.position);
         }
     }
 
     void showReminders() {
+        TRACE_SPAN("reminders");
         cout << "\n===== Reminders =====\n";
 
+        Perf::Timer timer(Perf::REMINDERS);
         vector<int> overdue, dueSoon;
-        for (size_t i = 0; i < tasks.size(); ++i) {
-            if (tasks[i].isOverdue()) overdue.push_back(i);
-            else if (tasks[i].isDueSoon()) dueSoon.push_back(i);
+        for (size_t i = 0; i < store.tasks.size(); ++i) {
+            if (!store.isLive(i)) continue;
+            if (store.tasks[i].isOverdue()) overdue.push_back(i);
+            else if (store.tasks[i].isDueSoon()) dueSoon.push_back(i);
         }
+        timer.stop();
 
         if (!overdue.empty()) {
             cout << "OVERDUE TASKS:\n";
@@ -495,68 +6282,172 @@ public:
         }
     }
 
+    // Every pending occurrence in a date window, recurring tasks expanded from their rules
+    void showCalendar() {
+        string from, to;
+        int32_t fromDay, toDay;
+        cout << "Start date (YYYY-MM-DD, or press Enter for today): ";
+        getline(cin, from);
+        if (from.empty()) from = DateUtils::getCurrentDate();
+        if (!DateUtils::toDayNumber(from, fromDay)) {
+            cout << "Invalid date format. Please use YYYY-MM-DD.\n";
+            return;
+        }
+        cout << "End date (YYYY-MM-DD, or press Enter for 30 days later): ";
+        getline(cin, to);
+        if (to.empty()) toDay = fromDay + 30;
+        else if (!DateUtils::toDayNumber(to, toDay) || toDay < fromDay) {
+            cout << "Invalid end date.\n";
+            return;
+        }
+
+        char first[10], last[10], day[10];
+        cout << "\n===== Calendar " << DateUtils::formatDay(fromDay, first) << " to "
+             << DateUtils::formatDay(toDay, last) << " =====\n";
+        size_t shown = 0;
+        store.forEachOccurrence(fromDay, toDay, [&](int32_t when, const Task& task) {
+            cout << DateUtils::formatDay(when, day) << "  " << task.getDescription()
+                 << " (Priority: " << task.getPriorityString() << ", Category: " << task.getCategory();
+            if (task.getIsRecurring()) cout << ", " << task.getRecurringType();
+            cout << ")\n";
+            shown++;
+        });
+        if (shown == 0) cout << "Nothing scheduled.\n";
+        else cout << shown << " occurrence(s).\n";
+    }
+
+    // Completes or deletes every task matching a filter in one pass, undone
+    // as a single action
+    void bulkOperation() {
+        cout << "Bulk action: 1. Complete 2. Delete\n";
+        cout << "Choose option: ";
+        int choice;
+        cin >> choice;
+        cin.ignore();
+        if (choice != 1 && choice != 2) {
+            cout << "Invalid option.\n";
+            return;
+        }
+
+        string text, error;
+        cout << "Filter (e.g. category=Work and completed, due<2025-01-01 and priority<=2): ";
+        getline(cin, text);
+        TaskFilter filter;
+        if (!filter.parse(text, error)) {
+            cout << "Invalid filter: " << error << "\n";
+            return;
+        }
+
+        string today = DateUtils::getCurrentDate();
+        auto pred = [&](const Task& task) { return filter.matches(task, today); };
+        size_t matching = store.scan(pred, parallelPool()).size();
+        if (matching == 0) {
+            cout << "No tasks match.\n";
+            return;
+        }
+
+        char confirm;
+        cout << matching << " task(s) match. " << (choice == 1 ? "Complete" : "Delete") << " them? (y/n): ";
+        cin >> confirm;
+        cin.ignore();
+        if (confirm != 'y' && confirm != 'Y') return;
+
+        vector<pair<int, Task>> affected;
+        size_t count;
+        if (choice == 1) {
+            count = store.completeWhere(pred, &affected);
+        } else {
+            count = store.removeWhere(pred, &affected);
+            store.compactIfNeeded();
+        }
+        if (count > 0) addToHistory(Action(choice == 1 ? Action::BULK_COMPLETE : Action::BULK_DELETE, std::move(affected)));
+        cout << count << " task(s) " << (choice == 1 ? "completed" : "deleted") << ".\n";
+    }
+
     void undoLastAction() {
         if (actionHistory.empty()) {
             cout << "No actions to undo.\n";
             return;
         }
 
+        Perf::Timer timer(Perf::UNDO);
         Action lastAction = actionHistory.back();
         actionHistory.pop_back();
 
         switch (lastAction.type) {
-            case Action::ADD:
+            case Action::ADD: {
                 // Remove the last added task
-                for (auto it = tasks.begin(); it != tasks.end(); ++it) {
-                    if (it->getId() == lastAction.task.getId()) {
-                        tasks.erase(it);
-                        break;
-                    }
-                }
+                int index = store.indexOf(lastAction.task.getId());
+                if (index >= 0) store.undoAdd(index);
+                store.compactIfNeeded();
                 cout << "Task addition undone.\n";
                 break;
+            }
 
             case Action::DELETE:
-                // Re-add the deleted task
-                if (lastAction.index >= 0 && lastAction.index <= (int)tasks.size()) {
-                    tasks.insert(tasks.begin() + lastAction.index, lastAction.task);
-                    cout << "Task deletion undone.\n";
-                }
+                // Revive the deleted task
+                store.restore({{lastAction.index, lastAction.task}});
+                cout << "Task deletion undone.\n";
                 break;
 
-            case Action::COMPLETE:
-                // Mark task as pending
-                for (auto& task : tasks) {
-                    if (task.getId() == lastAction.task.getId()) {
-                        task.markPending();
-                        cout << "Task completion undone.\n";
-                        break;
-                    }
+            case Action::COMPLETE: {
+                // Restore the task as it was, which also rewinds a recurring
+                // task to the occurrence that was completed
+                int index = store.locate(lastAction.task.getId(), lastAction.index);
+                if (index >= 0) {
+                    store.undoComplete(index, lastAction.task);
+                    cout << "Task completion undone.\n";
                 }
                 break;
+            }
 
-            case Action::EDIT:
+            case Action::EDIT: {
                 // Restore previous version
-                if (lastAction.index >= 0 && lastAction.index < (int)tasks.size()) {
-                    tasks[lastAction.index] = lastAction.task;
+                int index = store.locate(lastAction.task.getId(), lastAction.index);
+                if (index >= 0) {
+                    store.modify(index) = lastAction.task;
+                    store.markDirty(index);
                     cout << "Task edit undone.\n";
                 }
                 break;
+            }
+
+            case Action::BULK_COMPLETE:
+                for (const auto& [hint, task] : lastAction.group) {
+                    int index = store.locate(task.getId(), hint);
+                    if (index >= 0) store.undoComplete(index, task);
+                }
+                cout << "Bulk completion of " << lastAction.group.size() << " task(s) undone.\n";
+                break;
+
+            case Action::BULK_DELETE:
+                store.restore(lastAction.group);
+                cout << "Bulk deletion of " << lastAction.group.size() << " task(s) undone.\n";
+                break;
         }
     }
 
     // Display methods
+    // Numbers are positions in the task list; deleted tasks leave a gap
+    // until the list is compacted
     void displayTask(size_t index) const {
-        if (index >= tasks.size()) return;
+        if (!store.isLive(index)) return;
 
-        const Task& task = tasks[index];
+        const Task& task = store.tasks[index];
         cout << index + 1 << ". [" << (task.getIsCompleted() ? "✓" : " ") << "] ";
         cout << task.getDescription();
         cout << " (Priority: " << task.getPriorityString();
         cout << ", Due: " << task.getDueDate();
         cout << ", Category: " << task.getCategory();
         if (task.getIsRecurring()) {
-            cout << ", Recurring: " << task.getRecurringType();
+            const RecurrenceRule& rule = task.getRecurrence();
+            static const char* units[] = {"", "days", "weeks", "months"};
+            if (rule.interval > 1) cout << ", Recurring: every " << rule.interval << " " << units[rule.frequency];
+            else cout << ", Recurring: " << rule.name();
+            if (rule.hasEnd()) {
+                char until[10];
+                cout << " until " << DateUtils::formatDay(rule.untilDay, until);
+            }
         }
         if (task.isOverdue()) cout << " - OVERDUE!";
         else if (task.isDueSoon()) cout << " - Due Soon!";
@@ -564,58 +6455,77 @@ public:
     }
 
     void displayTasks() const {
-        if (tasks.empty()) {
+        if (store.empty()) {
             cout << "No tasks to display.\n";
             return;
         }
+        TRACE_SPAN("render list");
         cout << "\nTo-Do List for " << currentUser << ":\n";
-        for (size_t i = 0; i < tasks.size(); ++i) {
+        for (size_t i = 0; i < store.tasks.size(); ++i) {
             displayTask(i);
         }
     }
 
     void displayTasksSortedByDueDate() const {
-        if (tasks.empty()) {
+        if (store.empty()) {
             cout << "No tasks to display.\n";
             return;
         }
-        vector<Task> sortedTasks = tasks;
-        sort(sortedTasks.begin(), sortedTasks.end(), [](const Task& a, const Task& b) {
-            return a.getDueDate() < b.getDueDate();
+        // Sort a permutation of indices rather than copies of the tasks
+        TRACE_SPAN("render by due");
+        Perf::Timer timer(Perf::SORT_BY_DUE);
+        vector<size_t> order;
+        order.reserve(store.liveCount());
+        for (size_t i = 0; i < store.tasks.size(); ++i) {
+            if (store.isLive(i)) order.push_back(i);
+        }
+        sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+            return store.tasks[a].getDueDate() < store.tasks[b].getDueDate();
         });
+        timer.stop();
 
         cout << "\nTo-Do List (Sorted by Due Date):\n";
-        for (size_t i = 0; i < sortedTasks.size(); ++i) {
-            cout << i + 1 << ". [" << (sortedTasks[i].getIsCompleted() ? "✓" : " ") << "] ";
-            cout << sortedTasks[i].getDescription();
-            cout << " (Priority: " << sortedTasks[i].getPriorityString();
-            cout << ", Due: " << sortedTasks[i].getDueDate();
-            cout << ", Category: " << sortedTasks[i].getCategory() << ")\n";
+        for (size_t i = 0; i < order.size(); ++i) {
+            const Task& task = store.tasks[order[i]];
+            cout << i + 1 << ". [" << (task.getIsCompleted() ? "✓" : " ") << "] ";
+            cout << task.getDescription();
+            cout << " (Priority: " << task.getPriorityString();
+            cout << ", Due: " << task.getDueDate();
+            cout << ", Category: " << task.getCategory() << ")\n";
         }
     }
 
     void displayTasksSortedByPriority() const {
-        if (tasks.empty()) {
+        if (store.empty()) {
             cout << "No tasks to display.\n";
             return;
         }
-        vector<Task> sortedTasks = tasks;
-        sort(sortedTasks.begin(), sortedTasks.end(), [](const Task& a, const Task& b) {
-            return a.getPriority() < b.getPriority();
+        // Sort a permutation of indices rather than copies of the tasks
+        TRACE_SPAN("render by priority");
+        Perf::Timer timer(Perf::SORT_BY_PRIORITY);
+        vector<size_t> order;
+        order.reserve(store.liveCount());
+        for (size_t i = 0; i < store.tasks.size(); ++i) {
+            if (store.isLive(i)) order.push_back(i);
+        }
+        sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+            return store.tasks[a].getPriority() < store.tasks[b].getPriority();
         });
+        timer.stop();
 
         cout << "\nTo-Do List (Sorted by Priority):\n";
-        for (size_t i = 0; i < sortedTasks.size(); ++i) {
-            cout << i + 1 << ". [" << (sortedTasks[i].getIsCompleted() ? "✓" : " ") << "] ";
-            cout << sortedTasks[i].getDescription();
-            cout << " (Priority: " << sortedTasks[i].getPriorityString();
-            cout << ", Due: " << sortedTasks[i].getDueDate();
-            cout << ", Category: " << sortedTasks[i].getCategory() << ")\n";
+        for (size_t i = 0; i < order.size(); ++i) {
+            const Task& task = store.tasks[order[i]];
+            cout << i + 1 << ". [" << (task.getIsCompleted() ? "✓" : " ") << "] ";
+            cout << task.getDescription();
+            cout << " (Priority: " << task.getPriorityString();
+            cout << ", Due: " << task.getDueDate();
+            cout << ", Category: " << task.getCategory() << ")\n";
         }
     }
 
     void deleteTask() {
-        if (tasks.empty()) {
+        if (store.empty()) {
             cout << "No tasks to delete.\n";
             return;
         }
@@ -623,19 +6533,19 @@ public:
         int idx;
         cout << "Enter the task number to delete: ";
         cin >> idx;
-        if (idx < 1 || idx > (int)tasks.size()) {
+        if (idx < 1 || !store.isLive(idx - 1)) {
             cout << "Invalid task number.\n";
             return;
         }
 
-        Task deletedTask = tasks[idx - 1];
-        tasks.erase(tasks.begin() + idx - 1);
-        addToHistory(Action::DELETE, deletedTask, idx - 1);
+        addToHistory(Action::DELETE, store.tasks[idx - 1], idx - 1);
+        store.remove(idx - 1);
+        if (store.compactIfNeeded()) cout << "Task list renumbered.\n";
         cout << "Task deleted successfully!\n";
     }
 
     void markTaskCompleted() {
-        if (tasks.empty()) {
+        if (store.empty()) {
             cout << "No tasks to mark as completed.\n";
             return;
         }
@@ -643,20 +6553,18 @@ public:
         int idx;
         cout << "Enter the task number to mark as completed: ";
         cin >> idx;
-        if (idx < 1 || idx > (int)tasks.size()) {
+        if (idx < 1 || !store.isLive(idx - 1)) {
             cout << "Invalid task number.\n";
             return;
         }
 
-        Task oldTask = tasks[idx - 1];
-        tasks[idx - 1].markCompleted();
-        addToHistory(Action::COMPLETE, oldTask);
+        Task oldTask = store.tasks[idx - 1];
+        bool advanced = store.complete(idx - 1);
+        addToHistory(Action::COMPLETE, oldTask, idx - 1);
 
-        // Handle recurring tasks
-        if (tasks[idx - 1].getIsRecurring()) {
-            Task nextTask = tasks[idx - 1].createNextOccurrence();
-            tasks.push_back(nextTask);
-            cout << "Task marked as completed! Next occurrence created.\n";
+        // Recurring tasks stay in place with their next due date
+        if (advanced) {
+            cout << "Task marked as completed! Next occurrence due " << store.tasks[idx - 1].getDueDate() << ".\n";
         } else {
             cout << "Task marked as completed!\n";
         }
@@ -664,83 +6572,581 @@ public:
 
 private:
     void addToHistory(Action::Type type, const Task& task, int index = -1) {
-        actionHistory.push_back(Action(type, task, index));
+        addToHistory(Action(type, task, index));
+    }
+
+    void addToHistory(const Action& action) {
+        actionHistory.emplace_back(action, &historyMemory);
         if (actionHistory.size() > MAX_HISTORY) {
             actionHistory.erase(actionHistory.begin());
         }
     }
 
-    void saveTasks() {
-        if (currentUser.empty()) return;
+    ThreadPool& workers() {
+        if (!pool) pool = make_unique<ThreadPool>(workerThreads);
+        return *pool;
+    }
+
+    // Pool for the parallel load/scan paths, or null when running single-threaded
+    ThreadPool* parallelPool() {
+        return workerThreads > 1 ? &workers() : nullptr;
+    }
+
+    // Reads names[first, first + count)'s task files and journals as one
+    // batch; user i's files are at files[i * USER_FILES + TASKS] and on.
+    // Files a user doesn't have come back with ok unset and no contents.
+    static vector<AsyncIo::Op> readUserFiles(const vector<string>& names, size_t first, size_t count) {
+        vector<AsyncIo::Op> files;
+        files.reserve(count * USER_FILES);
+        for (size_t i = first; i < first + count; ++i) {
+            files.push_back(AsyncIo::Op::read(names[i] + "_tasks.txt"));
+            files.push_back(AsyncIo::Op::read(TaskStore::sealedPath(names[i])));
+            files.push_back(AsyncIo::Op::read(TaskStore::journalPath(names[i])));
+        }
+        AsyncIo::run(files);
+        return files;
+    }
+};
+
+// Bounded cache of the user task sets the server keeps in memory. A user is
+// loaded on first access; once a shard holds more than its share of the memory
+// budget, its least recently used users are written back if dirty and dropped.
+// The table is sharded so lookups for different users rarely contend, and each
+// resident user also has a lock that serializes its requests.
+class ResidentUsers {
+public:
+    struct Counters {
+        uint64_t hits, misses, evictions;
+        size_t residents, bytes, budget;
+    };
+
+private:
+    struct Resident {
+        mutex lock;
+        TaskStore store;
+        int pins = 0;                  // requests in flight; guarded by the shard lock
+        size_t charged = 0;            // bytes counted against the shard; guarded by the shard lock
+        list<string>::iterator lruPos;
+    };
 
-        string filename = currentUser + "_tasks.txt";
-        ofstream file(filename);
-        if (file.is_open()) {
-            for (const auto& task : tasks) {
-                file << task.getId() << "|" << task.getDescription() << "|"
-                     << task.getIsCompleted() << "|" << task.getPriority() << "|"
-                     << task.getDueDate() << "|" << task.getCategory() << "|"
-                     << task.getIsRecurring() << "|" << task.getRecurringType() << "\n";
+    struct Shard {
+        mutex lock;
+        unordered_map<string, unique_ptr<Resident>> residents;
+        list<string> lru; // most recently used first
+        size_t bytes = 0;
+    };
+
+    static constexpr size_t SHARD_COUNT = 16;
+    Shard shards[SHARD_COUNT];
+    size_t budget;
+    atomic<uint64_t> hits{0}, misses{0}, evictions{0};
+
+    Shard& shardFor(const string& username) {
+        return shards[hash<string>{}(username) % SHARD_COUNT];
+    }
+
+    Resident& pin(Shard& shard, const string& username) {
+        lock_guard<mutex> guard(shard.lock);
+        auto it = shard.residents.find(username);
+        if (it == shard.residents.end()) {
+            misses++;
+            it = shard.residents.emplace(username, make_unique<Resident>()).first;
+            it->second->lruPos = shard.lru.insert(shard.lru.begin(), username);
+        } else {
+            hits++;
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second->lruPos);
+        }
+        it->second->pins++;
+        return *it->second;
+    }
+
+    void unpin(Shard& shard, Resident& resident, size_t bytes) {
+        lock_guard<mutex> guard(shard.lock);
+        resident.pins--;
+        shard.bytes = shard.bytes - resident.charged + bytes;
+        resident.charged = bytes;
+        evictOverBudget(shard);
+    }
+
+    // Walks the shard from its least recently used end, never touching the
+    // most recent user or anyone with a request in flight. Shard lock held.
+    void evictOverBudget(Shard& shard) {
+        size_t shardBudget = budget / SHARD_COUNT;
+        auto it = shard.lru.end();
+        while (shard.bytes > shardBudget && it != shard.lru.begin() && --it != shard.lru.begin()) {
+            auto found = shard.residents.find(*it);
+            Resident& victim = *found->second;
+            if (victim.pins > 0) continue;
+
+            // Unpinned users can only be reached through this shard's lock,
+            // so nothing else can be holding theirs
+            lock_guard<mutex> victimGuard(victim.lock);
+            if (victim.store.isDirty()) victim.store.save();
+            shard.bytes -= victim.charged;
+            it = shard.lru.erase(it);
+            shard.residents.erase(found);
+            evictions++;
+        }
+    }
+
+public:
+    explicit ResidentUsers(size_t budgetBytes) : budget(budgetBytes) {}
+
+    // Runs fn(store) with the user's lock held, loading the task file on first use
+    template <class F>
+    auto withUser(const string& username, ThreadPool* pool, F fn) {
+        Shard& shard = shardFor(username);
+        Resident& resident = pin(shard, username);
+        try {
+            unique_lock<mutex> guard(resident.lock);
+            if (!resident.store.isOpen()) resident.store.open(username, pool);
+            auto result = fn(resident.store);
+            resident.store.compactIfNeeded();
+            size_t bytes = resident.store.memoryUsage();
+            guard.unlock();
+            unpin(shard, resident, bytes);
+            return result;
+        } catch (...) {
+            unpin(shard, resident, resident.charged);
+            throw;
+        }
+    }
+
+    // Writes back every dirty user in one TaskStore::saveAll
+    void flushAll() {
+        vector<unique_lock<mutex>> held;
+        vector<TaskStore*> dirty;
+        for (auto& shard : shards) held.emplace_back(shard.lock);
+        for (auto& shard : shards) {
+            for (auto& pair : shard.residents) {
+                held.emplace_back(pair.second->lock);
+                if (pair.second->store.isDirty()) dirty.push_back(&pair.second->store);
             }
-            file.close();
         }
+        TaskStore::saveAll(dirty);
     }
 
-    void loadTasks() {
-        if (currentUser.empty()) return;
+    Counters counters() {
+        Counters result{hits, misses, evictions, 0, 0, budget};
+        for (auto& shard : shards) {
+            lock_guard<mutex> guard(shard.lock);
+            result.residents += shard.residents.size();
+            result.bytes += shard.bytes;
+        }
+        return result;
+    }
+};
 
-        tasks.clear();
-        string filename = currentUser + "_tasks.txt";
-        ifstream file(filename);
-        if (file.is_open()) {
-            string line;
-            while (getline(file, line)) {
-                istringstream ss(line);
-                string token;
-                vector<string> tokens;
+// Multi-user request server. Clients talk a line protocol with '|' separated
+// fields, the same convention as the task files:
+//   LOGIN|user|password          REGISTER|user|password
+//   ADD|priority|due|category|description[|daily/weekly/monthly[|interval[|until]]]
+//   COMPLETE|id                  SEARCH|description|category|priority|status|value
+//   QUERY|query                  TOP|n
+//   AGENDA|from|to
+//   BULK|complete/delete|filter
+//   ARCHIVE[|before]             (completed tasks to the archive; replies OK|n|text bytes|archive bytes)
+//   STATS    CACHE    SAVE    QUIT
+// Every reply starts with "OK|..." or "ERR|message". SEARCH, QUERY, TOP, AGENDA and STATS
+// reply "OK|n" followed by n lines (task lines in file format, date|id|description
+// occurrences, or key|value pairs).
+class TaskServer {
+private:
+    ToDoList& accounts;
+    mutex accountsLock;
+    ResidentUsers residents;
+    ThreadPool pool;
 
-                while (getline(ss, token, '|')) {
-                    tokens.push_back(token);
-                }
+    struct Client {
+        string user;
+        bool done = false;
+    };
 
-                if (tokens.size() >= 6) {
-                    Task task(tokens[1], stoi(tokens[3]), tokens[4], tokens[5]);
-                    if (tokens[2] == "1") task.markCompleted();
-                    if (tokens.size() >= 8 && tokens[6] == "1") {
-                        task.setRecurring(tokens[7]);
-                    }
-                    tasks.push_back(task);
+public:
+    TaskServer(ToDoList& accountList, unsigned threads, size_t cacheBytes)
+        : accounts(accountList), residents(cacheBytes), pool(threads) {}
+
+    // Serves requests read from in until QUIT or end of input
+    void runBatch(istream& in, ostream& out) {
+        Client client;
+        string line;
+        while (!client.done && getline(in, line)) {
+            out << execute(client, line);
+        }
+        out.flush();
+        finish(client);
+        residents.flushAll();
+    }
+
+#ifdef TASKREAPER_HAS_UNIX_SOCKETS
+    // Accepts clients on a Unix domain socket until SIGINT/SIGTERM, one thread per client
+    int listenOn(const string& socketPath) {
+        sockaddr_un addr{};
+        if (socketPath.size() >= sizeof(addr.sun_path)) {
+            cerr << "Socket path too long: " << socketPath << "\n";
+            return 1;
+        }
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(socketPath.c_str());
+        if (listener < 0 || ::bind(listener, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listener, 64) < 0) {
+            cerr << "Cannot listen on " << socketPath << ": " << strerror(errno) << "\n";
+            if (listener >= 0) close(listener);
+            return 1;
+        }
+
+        stopRequested = 0;
+        signal(SIGINT, onStopSignal);
+        signal(SIGTERM, onStopSignal);
+        signal(SIGPIPE, SIG_IGN);
+        cout << "TaskReaper server listening on " << socketPath << "\n";
+
+        mutex clientsLock;
+        condition_variable clientsDone;
+        vector<int> clientFds;
+
+        while (!stopRequested) {
+            pollfd ready{listener, POLLIN, 0};
+            if (poll(&ready, 1, 200) <= 0) continue;
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd < 0) continue;
+
+            lock_guard<mutex> guard(clientsLock);
+            clientFds.push_back(fd);
+            thread([this, fd, &clientsLock, &clientsDone, &clientFds] {
+                serveClient(fd);
+                lock_guard<mutex> guard(clientsLock);
+                clientFds.erase(find(clientFds.begin(), clientFds.end(), fd));
+                close(fd);
+                clientsDone.notify_all();
+            }).detach();
+        }
+
+        close(listener);
+        unlink(socketPath.c_str());
+
+        // Wake clients blocked in recv() and wait for their threads to finish
+        unique_lock<mutex> lock(clientsLock);
+        for (int fd : clientFds) shutdown(fd, SHUT_RDWR);
+        clientsDone.wait(lock, [&] { return clientFds.empty(); });
+        lock.unlock();
+
+        residents.flushAll();
+        cout << "TaskReaper server stopped.\n";
+        return 0;
+    }
+#endif
+
+private:
+#ifdef TASKREAPER_HAS_UNIX_SOCKETS
+    static inline volatile sig_atomic_t stopRequested = 0;
+
+    static void onStopSignal(int) { stopRequested = 1; }
+
+    void serveClient(int fd) {
+        Client client;
+        string pending;
+        char buffer[4096];
+        while (!client.done) {
+            ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+            if (got <= 0) break;
+            pending.append(buffer, (size_t)got);
+
+            size_t start = 0, eol;
+            string replies;
+            while (!client.done && (eol = pending.find('\n', start)) != string::npos) {
+                string_view line(pending.data() + start, eol - start);
+                if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+                replies += execute(client, line);
+                start = eol + 1;
+            }
+            pending.erase(0, start);
+
+            for (size_t sent = 0; sent < replies.size();) {
+                ssize_t n = send(fd, replies.data() + sent, replies.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0) {
+                    client.done = true;
+                    break;
                 }
+                sent += (size_t)n;
             }
-            file.close();
         }
+        finish(client);
     }
+#endif
 
-    void saveUsers() {
-        ofstream file("users.txt");
-        if (file.is_open()) {
-            for (const auto& pair : users) {
-                if (!pair.second.getUsername().empty()) {
-                    file << pair.second.getUsername() << "|" << "encrypted_password" << "\n";
+    // Writes the client's tasks back if this session changed them
+    void finish(Client& client) {
+        if (client.user.empty()) return;
+        residents.withUser(client.user, &pool, [](TaskStore& store) {
+            if (store.isDirty()) store.save();
+            return 0;
+        });
+        client.user.clear();
+    }
+
+    static string error(string_view message) {
+        return "ERR|" + string(message) + "\n";
+    }
+
+    string execute(Client& client, string_view request) {
+        string_view fields[8];
+        size_t count = StringUtils::split(request, '|', fields, 8);
+        string_view command = fields[0];
+        TRACE_SPAN("request", command);
+
+        if (command == "QUIT") {
+            client.done = true;
+            return "OK|bye\n";
+        }
+        if (command == "LOGIN" || command == "REGISTER") {
+            if (count < 3 || fields[1].empty()) return error("usage: " + string(command) + "|user|password");
+            string user(fields[1]), password(fields[2]);
+            lock_guard<mutex> guard(accountsLock);
+            if (command == "REGISTER") {
+                return accounts.registerUser(user, password) ? "OK|registered\n" : error("username taken");
+            }
+            if (!accounts.authenticate(user, password)) return error("invalid credentials");
+            finish(client);
+            client.user = user;
+            return "OK|" + user + "\n";
+        }
+        if (client.user.empty()) return error("login required");
+
+        if (command == "ADD") {
+            if (count < 5) return error("usage: ADD|priority|due|category|description");
+            int priority = StringUtils::toInt(fields[1]);
+            string due(fields[2]);
+            if (priority < 1 || priority > 3) return error("priority must be 1-3");
+            if (!DateUtils::isValidDate(due)) return error("due date must be YYYY-MM-DD");
+            string_view category = fields[3].empty() ? string_view("General") : fields[3];
+
+            RecurrenceRule rule;
+            if (count >= 6) {
+                rule.frequency = RecurrenceRule::parseFrequency(fields[5]);
+                if (!rule.active()) return error("recurrence must be daily, weekly or monthly");
+                int interval = count >= 7 ? StringUtils::toInt(fields[6], 1) : 1;
+                if (interval < 1 || interval > 365) return error("interval must be 1-365");
+                rule.interval = (uint16_t)interval;
+                DateUtils::toDayNumber(due, rule.startDay);
+                if (count >= 8 && !fields[7].empty() && !DateUtils::toDayNumber(fields[7], rule.untilDay)) {
+                    return error("until date must be YYYY-MM-DD");
                 }
             }
-            file.close();
+
+            uint64_t id = residents.withUser(client.user, &pool, [&](TaskStore& store) {
+                return store.add(fields[4], priority, due, category, rule).getId();
+            });
+            return "OK|" + to_string(id) + "\n";
         }
-    }
+        if (command == "COMPLETE") {
+            if (count < 2) return error("usage: COMPLETE|id");
+            uint64_t id = StringUtils::toU64(fields[1]);
+            return residents.withUser(client.user, &pool, [&](TaskStore& store) {
+                int index = store.indexOf(id);
+                if (index < 0) return error("no such task");
+                bool advanced = store.complete(index);
+                return advanced ? "OK|next|" + string(store.tasks[index].getDueDate()) + "\n" : string("OK|completed\n");
+            });
+        }
+        if (command == "AGENDA") {
+            if (count < 3) return error("usage: AGENDA|from|to");
+            int32_t fromDay, toDay;
+            if (!DateUtils::toDayNumber(fields[1], fromDay) || !DateUtils::toDayNumber(fields[2], toDay)) {
+                return error("dates must be YYYY-MM-DD");
+            }
+            return residents.withUser(client.user, &pool, [&](TaskStore& store) {
+                string body;
+                size_t lines = 0;
+                char day[10];
+                store.forEachOccurrence(fromDay, toDay, [&](int32_t when, const Task& task) {
+                    body.append(DateUtils::formatDay(when, day)).append("|").append(to_string(task.getId()))
+                        .append("|").append(task.getDescription()).append("\n");
+                    lines++;
+                });
+                return "OK|" + to_string(lines) + "\n" + body;
+            });
+        }
+        if (command == "BULK") {
+            if (count < 3 || (fields[1] != "complete" && fields[1] != "delete")) {
+                return error("usage: BULK|complete/delete|filter");
+            }
+            TaskFilter filter;
+            string message;
+            if (!filter.parse(fields[2], message)) return error(message);
+            string today = DateUtils::getCurrentDate();
+            auto pred = [&](const Task& task) { return filter.matches(task, today); };
+            size_t changed = residents.withUser(client.user, &pool, [&](TaskStore& store) {
+                return fields[1] == "complete" ? store.completeWhere(pred) : store.removeWhere(pred);
+            });
+            return "OK|" + to_string(changed) + "\n";
+        }
+        if (command == "ARCHIVE") {
+            int32_t before = INT32_MAX;
+            if (count >= 2 && !fields[1].empty() && !DateUtils::toDayNumber(fields[1], before)) {
+                return error("usage: ARCHIVE[|before] with a YYYY-MM-DD date");
+            }
+            TaskArchive::Report report = residents.withUser(client.user, &pool, [&](TaskStore& store) {
+                return TaskArchive::archiveCompleted(store, before);
+            });
+            if (!report.failure.empty()) return error(report.failure);
+            return "OK|" + to_string(report.archived) + "|" + to_string(report.sourceBytes) + "|" +
+                   to_string(report.archiveBytes) + "\n";
+        }
+        if (command == "SEARCH") {
+            if (count < 3) return error("usage: SEARCH|description|category|priority|status|value");
+            string_view mode = fields[1];
+            string value(fields[2]);
+            string today = DateUtils::getCurrentDate();
+            transform(value.begin(), value.end(), value.begin(), ::tolower);
+            int priority = StringUtils::toInt(value);
 
-    void loadUsers() {
-        ifstream file("users.txt");
-        if (file.is_open()) {
-            string line;
-            while (getline(file, line)) {
-                istringstream ss(line);
-                string username, password;
-                getline(ss, username, '|');
-                getline(ss, password, '|');
-                users.insert(make_pair(username, User(username, password)));
+            function<bool(const Task&)> pred;
+            if (mode == "description") {
+                pred = [&](const Task& task) { return StringUtils::containsIgnoreCase(task.getDescription(), value); };
+            } else if (mode == "category") {
+                string category(fields[2]);
+                pred = [category](const Task& task) { return task.getCategory() == category; };
+            } else if (mode == "priority") {
+                pred = [priority](const Task& task) { return task.getPriority() == priority; };
+            } else if (mode == "status" && (value == "completed" || value == "pending" || value == "overdue")) {
+                pred = [&](const Task& task) {
+                    if (value == "completed") return task.getIsCompleted();
+                    if (value == "pending") return !task.getIsCompleted() && !task.isOverdue(today);
+                    return task.isOverdue(today);
+                };
+            } else {
+                return error("unknown search mode");
             }
-            file.close();
+
+            Perf::Operation op = mode == "description" ? Perf::SEARCH_DESCRIPTION
+                               : mode == "category"  ? Perf::SEARCH_CATEGORY
+                               : mode == "priority"  ? Perf::SEARCH_PRIORITY
+                                                     : Perf::SEARCH_STATUS;
+            return residents.withUser(client.user, &pool, [&](TaskStore& store) {
+                Perf::Timer timer(op);
+                vector<int> results = store.scan(pred, &pool);
+                timer.stop();
+                ostringstream out;
+                out << "OK|" << results.size() << "\n";
+                for (int idx : results) TaskStore::writeTask(out, store.tasks[idx]);
+                return out.str();
+            });
+        }
+        if (command == "TOP") {
+            size_t limit = count >= 2 ? StringUtils::toU64(fields[1]) : 0;
+            if (limit == 0) return error("usage: TOP|n");
+            return residents.withUser(client.user, &pool, [&](TaskStore& store) {
+                const auto& top = store.topUrgent(limit);
+                ostringstream out;
+                out << "OK|" << top.size() << "\n";
+                for (const auto& entry : top) TaskStore::writeTask(out, store.tasks[entry.position]);
+                return out.str();
+            });
+        }
+        if (command == "QUERY") {
+            if (count < 2) return error("usage: QUERY|query");
+            TaskQuery query;
+            string message;
+            if (!query.parse(fields[1], message)) return error(message);
+            return residents.withUser(client.user, &pool, [&](TaskStore& store) {
+                vector<int> results = store.query(query, &pool);
+                ostringstream out;
+                out << "OK|" << results.size() << "\n";
+                for (int idx : results) TaskStore::writeTask(out, store.tasks[idx]);
+                return out.str();
+            });
+        }
+        if (command == "STATS") {
+            TaskStats stats = residents.withUser(client.user, &pool, [&](TaskStore& store) {
+                return store.stats(&pool);
+            });
+            ostringstream out;
+            out << "OK|" << 7 + stats.categories.size() << "\n"
+                << "total|" << stats.total << "\ncompleted|" << stats.completed << "\n"
+                << "pending|" << stats.pending << "\noverdue|" << stats.overdue << "\n"
+                << "high|" << stats.high << "\nmedium|" << stats.medium << "\nlow|" << stats.low << "\n";
+            for (const auto& pair : stats.categories) out << "category:" << pair.first << "|" << pair.second << "\n";
+            return out.str();
+        }
+        if (command == "TRENDS") {
+            // Totals over from..to (default: the last 30 days)
+            int32_t today = DateUtils::todayNumber(), from = today - 29, to = today;
+            if ((count >= 2 && !fields[1].empty() && !DateUtils::toDayNumber(fields[1], from)) ||
+                (count >= 3 && !fields[2].empty() && !DateUtils::toDayNumber(fields[2], to)) || to < from) {
+                return error("usage: TRENDS[|from|to] with YYYY-MM-DD dates");
+            }
+            return residents.withUser(client.user, &pool, [&](TaskStore& store) {
+                const TrendCounters& trends = store.trends();
+                int64_t completed = trends.total(TrendCounters::COMPLETED, from, to);
+                int32_t overdue = trends.lastOverdue(from, to);
+                char date[10];
+                ostringstream out;
+                out << "OK|8\n"
+                    << "from|" << DateUtils::formatDay(from, date) << "\nto|" << DateUtils::formatDay(to, date) << "\n"
+                    << "created|" << trends.total(TrendCounters::CREATED, from, to) << "\ncompleted|" << completed << "\n"
+                    << "per_day|" << (double)completed / (to - from + 1) << "\n"
+                    << "overdue|" << (overdue == TrendCounters::NO_SAMPLE ? "" : to_string(overdue)) << "\n"
+                    << "streak|" << trends.streak(today) << "\nlongest_streak|" << trends.longestStreak() << "\n";
+                return out.str();
+            });
         }
+        if (command == "PERF") {
+            // PERF: one line per timed operation; PERF|json: the JSON dump
+            ostringstream out;
+            if (count >= 2 && fields[1] == "json") {
+                out << "OK|1\n";
+                Perf::writeJson(out);
+                out << "\n";
+                return out.str();
+            }
+            if (count >= 2 && fields[1] == "reset") {
+                Perf::reset();
+                return "OK|reset\n";
+            }
+            ostringstream lines;
+            size_t timed = 0;
+            for (int op = 0; op < Perf::OPERATION_COUNT; ++op) {
+                LatencyHistogram::Summary s = Perf::histogram((Perf::Operation)op).summary();
+                if (s.count == 0) continue;
+                lines << Perf::name((Perf::Operation)op) << "|" << s.count << "|" << s.p50 << "|" << s.p99 << "|"
+                      << s.p999 << "|" << s.max << "\n";
+                timed++;
+            }
+            out << "OK|" << timed << "\n" << lines.str();
+            return out.str();
+        }
+        if (command == "MEMORY") {
+            TaskStore::MemoryReport report = residents.withUser(client.user, &pool, [](TaskStore& store) {
+                return store.memoryReport();
+            });
+            ostringstream out;
+            out << "OK|11\n"
+                << "tasks|" << report.liveTasks << "\nslots|" << report.slots << "\n"
+                << "task_objects|" << report.taskObjects << "\ndescriptions|" << report.descriptions << "\n"
+                << "categories|" << report.categories << "\ndue_dates|" << report.dueDates << "\n"
+                << "allocator_overhead|" << report.arenaOverhead << "\narena|" << report.arenaReserved << "\n"
+                << "indexes|" << report.indexes << "\nother|" << report.other << "\ntotal|" << report.total() << "\n";
+            return out.str();
+        }
+        if (command == "CACHE") {
+            ResidentUsers::Counters cache = residents.counters();
+            ostringstream out;
+            out << "OK|6\n"
+                << "hits|" << cache.hits << "\nmisses|" << cache.misses << "\nevictions|" << cache.evictions << "\n"
+                << "residents|" << cache.residents << "\nbytes|" << cache.bytes << "\nbudget|" << cache.budget << "\n";
+            return out.str();
+        }
+        if (command == "SAVE") {
+            residents.withUser(client.user, &pool, [](TaskStore& store) {
+                store.save();
+                return 0;
+            });
+            return "OK|saved\n";
+        }
+        return error("unknown command");
     }
 };
 
@@ -766,15 +7172,87 @@ void displayMainMenu() {
     cout << "9. Task Statistics\n";
     cout << "10. Show Reminders\n";
     cout << "11. Undo Last Action\n";
-    cout << "12. Logout\n";
-    cout << "13. Exit\n";
+    cout << "12. Calendar (Upcoming Occurrences)\n";
+    cout << "13. Bulk Complete/Delete by Filter\n";
+    cout << "14. Top Most Urgent Tasks\n";
+    cout << "15. Import/Export Tasks (CSV, JSON lines)\n";
+    cout << "16. Performance Stats\n";
+    cout << "17. Memory Report\n";
+    cout << "18. Logout\n";
+    cout << "19. Exit\n";
     cout << "Choose an option: ";
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     ToDoList todo;
     int choice;
 
+    enum { INTERACTIVE, REPORT, ARROW_EXPORT, BATCH, SERVER } mode = INTERACTIVE;
+    string socketPath = "taskreaper.sock";
+    string arrowPath;
+    size_t cacheBytes = size_t(256) << 20;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            todo.setWorkerThreads((unsigned)max(1, atoi(argv[++i])));
+        } else if (arg == "--cache-mb" && i + 1 < argc) {
+            cacheBytes = size_t(max(1, atoi(argv[++i]))) << 20;
+        } else if (arg == "--all-users-report") {
+            mode = REPORT;
+        } else if (arg == "--export-arrow" && i + 1 < argc) {
+            mode = ARROW_EXPORT;
+            arrowPath = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+#ifdef TASKREAPER_TRACING
+            Trace::start(argv[++i]);
+#else
+            ++i;
+            cerr << "Tracing is not built in; rebuild with -DTASKREAPER_TRACING=ON.\n";
+#endif
+        } else if (arg == "--durability" && i + 1 < argc) {
+            if (!Journal::Policy::parse(argv[++i], Journal::policy())) {
+                cerr << "Unknown durability '" << argv[i] << "'; expected always, none or group[:ms[:records]].\n";
+                return 1;
+            }
+        } else if (arg == "--io" && i + 1 < argc) {
+            string backend = argv[++i];
+            if (backend != "uring" && backend != "threads") {
+                cerr << "Unknown I/O backend '" << backend << "'; expected uring or threads.\n";
+                return 1;
+            }
+            AsyncIo::backend() = backend == "uring" ? AsyncIo::URING : AsyncIo::THREADS;
+#ifndef TASKREAPER_HAS_IO_URING
+            if (backend == "uring") cerr << "io_uring is not built in; rebuild with -DTASKREAPER_IO_URING=ON.\n";
+#endif
+        } else if (arg == "--batch") {
+            mode = BATCH;
+        } else if (arg == "--server") {
+            mode = SERVER;
+            if (i + 1 < argc && argv[i + 1][0] != '-') socketPath = argv[++i];
+        }
+    }
+
+    switch (mode) {
+        case REPORT:
+            todo.showAllUsersReport();
+            return 0;
+        case ARROW_EXPORT:
+            return todo.exportAllUsersArrow(arrowPath) ? 0 : 1;
+        case BATCH:
+            TaskServer(todo, todo.getWorkerThreads(), cacheBytes).runBatch(cin, cout);
+            return 0;
+        case SERVER:
+#ifdef TASKREAPER_HAS_UNIX_SOCKETS
+            return TaskServer(todo, todo.getWorkerThreads(), cacheBytes).listenOn(socketPath);
+#else
+            cerr << "Server mode needs Unix domain sockets, which this platform lacks.\n";
+            return 1;
+#endif
+        case INTERACTIVE:
+            break;
+    }
+
     cout << "🚀 Welcome to the Enhanced C++ To-Do List Application!\n";
 
     // Login/Registration loop
@@ -791,9 +7269,9 @@ int main() {
                 cout << "Password: ";
                 getline(cin, password);
 
-                if (todo.loginUser(username, password)) {
+                if (todo.loginUser(username, password, true)) {
                     cout << "Login successful! Welcome back, " << username << "!\n";
-                    todo.showReminders(); // Show reminders on login
+                    todo.showLoginSummary(); // Show reminders on login
                 } else {
                     cout << "Invalid credentials. Please try again.\n";
                 }
@@ -826,6 +7304,7 @@ int main() {
         displayMainMenu();
         cin >> choice;
         cin.ignore();
+        todo.waitForLoad();
 
         switch (choice) {
             case 1: todo.addTask(); break;
@@ -839,17 +7318,23 @@ int main() {
             case 9: todo.showStatistics(); break;
             case 10: todo.showReminders(); break;
             case 11: todo.undoLastAction(); break;
-            case 12:
+            case 12: todo.showCalendar(); break;
+            case 13: todo.bulkOperation(); break;
+            case 14: todo.showTopUrgent(); break;
+            case 15: todo.importExport(); break;
+            case 16: todo.showPerformance(); break;
+            case 17: todo.showMemoryReport(); break;
+            case 18:
                 todo.logoutUser();
                 cout << "Logged out successfully. Goodbye!\n";
                 return 0;
-            case 13:
+            case 19:
                 cout << "Saving data and exiting...\n";
                 break;
             default:
                 cout << "Invalid choice. Please try again.\n";
         }
-    } while (choice != 13);
+    } while (choice != 19);
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+// Counts heap allocations while the task list is displayed, sorted and
+// searched, at two list sizes. None of those paths may allocate per task:
+// the counts must not grow with the list, except for a search's result
+// vector, which grows geometrically.
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <unistd.h>
+
+static std::atomic<size_t> allocations{0};
+
+void* operator new(std::size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+#define main taskreaper_main
+#include "../main.cpp"
+#undef main
+
+// Swallows the listings without allocating
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize count) override { return count; }
+};
+
+struct Counts {
+    size_t display = 0, byDue = 0, byPriority = 0, searchNone = 0, searchAll = 0;
+};
+
+static void writeTasks(const string& owner, size_t count) {
+    ofstream out(owner + "_tasks.txt");
+    out << TaskFile::MAGIC << "|" << TaskFile::VERSION << "|" << count + 1 << "\n";
+    for (size_t i = 0; i < count; ++i) {
+        out << i + 1 << "|task number " << i << " with a description past the short-string limit|"
+            << (i % 3 == 0) << "|" << i % 3 + 1 << "|2099-" << setw(2) << setfill('0') << i % 12 + 1 << "-"
+            << setw(2) << i % 28 + 1 << setfill(' ') << "|category " << i % 7 << "|0|\n";
+    }
+}
+
+// Allocations made by fn, after one untimed call to warm up lazy statics
+template <class Fn>
+static size_t counted(Fn fn) {
+    fn();
+    size_t before = allocations;
+    fn();
+    return allocations - before;
+}
+
+static Counts measure(size_t taskCount) {
+    string owner = "user" + to_string(taskCount);
+    writeTasks(owner, taskCount);
+    ToDoList todo;
+    todo.setWorkerThreads(1);
+    todo.registerUser(owner, "password");
+    todo.loginUser(owner, "password");
+
+    // Search reads its choices from cin; the stream is built before counting
+    auto search = [&](const char* keyword) {
+        istringstream input(string("1\n") + keyword + "\n");
+        streambuf* saved = cin.rdbuf(input.rdbuf());
+        size_t count = counted([&] {
+            input.clear();
+            input.seekg(0);
+            cin.clear();
+            todo.searchTasks();
+        });
+        cin.rdbuf(saved);
+        return count;
+    };
+
+    Counts counts;
+    counts.display = counted([&] { todo.displayTasks(); });
+    counts.byDue = counted([&] { todo.displayTasksSortedByDueDate(); });
+    counts.byPriority = counted([&] { todo.displayTasksSortedByPriority(); });
+    counts.searchNone = search("absent");
+    counts.searchAll = search("task");
+    todo.logoutUser();
+    return counts;
+}
+
+int main() {
+    filesystem::path dir = filesystem::temp_directory_path() / ("taskreaper_alloc_" + to_string(getpid()));
+    filesystem::create_directories(dir);
+    filesystem::current_path(dir);
+
+    NullBuffer null;
+    streambuf* console = cout.rdbuf(&null);
+    Counts small = measure(1000), large = measure(4000);
+    cout.rdbuf(console);
+
+    int failures = 0;
+    auto check = [&](const char* path, size_t atSmall, size_t atLarge, size_t slack) {
+        bool ok = atLarge <= atSmall + slack;
+        cout << (ok ? "ok   " : "FAIL ") << path << ": " << atSmall << " allocations at 1000 tasks, " << atLarge
+             << " at 4000\n";
+        if (!ok) failures++;
+    };
+    check("display", small.display, large.display, 0);
+    check("sort by due date", small.byDue, large.byDue, 0);
+    check("sort by priority", small.byPriority, large.byPriority, 0);
+    check("search, no match", small.searchNone, large.searchNone, 0);
+    // Four times the matches: at most two more doublings of the result vector
+    check("search, all match", small.searchAll, large.searchAll, 2);
+
+    filesystem::current_path(filesystem::temp_directory_path());
+    filesystem::remove_all(dir);
+    return failures == 0 ? 0 : 1;
+}